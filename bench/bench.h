@@ -0,0 +1,119 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace vp8_bench {
+
+// Keep the compiler from discarding a value (or the work producing it).
+template <class T>
+inline void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() { asm volatile("" : : : "memory"); }
+
+// The directory of the test vectors: the first argument, or the
+// VP8_TEST_VECTORS environment variable used by the test scripts.
+inline std::string VectorDir(int argc, const char **argv) {
+  const char *env = std::getenv("VP8_TEST_VECTORS");
+  std::string dir = argc > 1 ? argv[1] : env ? env : "example/vp8-test-vectors";
+  if (!dir.empty() && dir.back() != '/') dir.push_back('/');
+  return dir;
+}
+
+struct Stats {
+  // Per operation, over the samples.
+  double median_ns, min_ns, max_ns;
+  // The median absolute deviation, relative to the median.
+  double mad;
+};
+
+// Run batch (which performs ops_per_batch operations) repeatedly and print the
+// time per operation. Each sample runs enough batches to last at least
+// kMinSampleTime so that the clock resolution does not matter; the median of
+// kNumSamples samples is reported along with its spread. If bytes_per_op is
+// non-zero, the throughput is printed as well.
+class Runner {
+ public:
+  static constexpr size_t kNumSamples = 15;
+  static constexpr std::chrono::milliseconds kMinSampleTime{20};
+
+  Runner() { PrintHeader(); }
+
+  template <class Batch>
+  Stats Run(const std::string &name, size_t ops_per_batch, double bytes_per_op,
+            Batch &&batch) {
+    using Clock = std::chrono::steady_clock;
+    // Warm up the caches and find the number of batches per sample.
+    size_t batches = 1;
+    while (true) {
+      auto start = Clock::now();
+      for (size_t i = 0; i < batches; ++i) batch();
+      ClobberMemory();
+      if (Clock::now() - start >= kMinSampleTime) break;
+      batches <<= 1;
+    }
+
+    std::vector<double> samples;
+    for (size_t s = 0; s < kNumSamples; ++s) {
+      auto start = Clock::now();
+      for (size_t i = 0; i < batches; ++i) batch();
+      ClobberMemory();
+      std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+      samples.push_back(elapsed.count() / double(batches * ops_per_batch));
+    }
+
+    Stats stats = Summarize(samples);
+    Print(name, stats, bytes_per_op);
+    return stats;
+  }
+
+ private:
+  static double Median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+  }
+
+  static Stats Summarize(const std::vector<double> &samples) {
+    Stats stats;
+    stats.median_ns = Median(samples);
+    stats.min_ns = *std::min_element(samples.begin(), samples.end());
+    stats.max_ns = *std::max_element(samples.begin(), samples.end());
+    std::vector<double> deviation;
+    for (double s : samples) deviation.push_back(std::fabs(s - stats.median_ns));
+    stats.mad = Median(deviation) / stats.median_ns;
+    return stats;
+  }
+
+  static void PrintHeader() {
+    std::printf("%-28s %12s %12s %12s %8s %14s\n", "benchmark", "ns/op",
+                "min ns/op", "max ns/op", "+/-", "throughput");
+  }
+
+  static void Print(const std::string &name, const Stats &stats,
+                    double bytes_per_op) {
+    std::printf("%-28s %12.2f %12.2f %12.2f %7.2f%%", name.c_str(),
+                stats.median_ns, stats.min_ns, stats.max_ns, stats.mad * 100);
+    if (bytes_per_op > 0) {
+      // Bytes per nanosecond are GB/s; report MB/s.
+      std::printf(" %9.1f MB/s", bytes_per_op / stats.median_ns * 1e3);
+    } else {
+      std::printf(" %8.2f Mop/s", 1e3 / stats.median_ns);
+    }
+    std::printf("\n");
+  }
+};
+
+}  // namespace vp8_bench
+
+#endif  // BENCH_H_
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../src/ivf.h"
+#include "../src/utils.h"
+#include "../src/vp8.h"
+#include "bench.h"
+
+namespace vp8_bench {
+namespace {
+
+constexpr char kUsage[] =
+    "[Usage] ./decode_bench [directory] [iterations (default: 10)] "
+    "[threads (default: 1)]";
+
+// The totals over the frames decoded from a stream or a group of streams.
+struct Totals {
+  size_t streams = 0, frames = 0;
+  double pixels = 0, bytes = 0, seconds = 0;
+  // The time of each call to Decoder::Decode, in microseconds.
+  std::vector<double> latencies;
+
+  void Add(const Totals &rhs) {
+    streams += rhs.streams;
+    frames += rhs.frames;
+    pixels += rhs.pixels;
+    bytes += rhs.bytes;
+    seconds += rhs.seconds;
+    latencies.insert(latencies.end(), rhs.latencies.begin(),
+                     rhs.latencies.end());
+  }
+};
+
+// The category of a test vector, e.g. "inter" for vp80-02-inter-1402.ivf.
+std::string Category(const std::string &name) {
+  size_t begin = name.find('-', name.find('-') + 1);
+  size_t end = name.rfind('-');
+  if (begin == std::string::npos || end <= begin) return "other";
+  return name.substr(begin + 1, end - begin - 1);
+}
+
+// Decode the whole stream iterations times with a new decoder each time.
+Totals DecodeStream(const std::string &path, size_t iterations,
+                    size_t num_threads) {
+  using Clock = std::chrono::steady_clock;
+  vp8::IvfReader ivf(path.c_str());
+  Totals totals;
+  totals.streams = 1;
+  for (size_t it = 0; it < iterations; ++it) {
+    vp8::Decoder decoder(num_threads);
+    for (size_t i = 0; i < ivf.size(); ++i) {
+      vp8::SpanReader<uint8_t> payload = ivf.Payload(i);
+      auto start = Clock::now();
+      std::optional<vp8::FrameView> frame =
+          decoder.Decode(payload.cursor(), payload.size());
+      std::chrono::duration<double> elapsed = Clock::now() - start;
+      DoNotOptimize(frame);
+      if (decoder.error() != nullptr)
+        ensure(false, path + ": frame " + std::to_string(i) + ": " +
+                          decoder.error());
+
+      totals.frames++;
+      totals.bytes += double(payload.size());
+      totals.seconds += elapsed.count();
+      totals.latencies.push_back(elapsed.count() * 1e6);
+      if (frame) totals.pixels += double(frame->width * frame->height);
+    }
+  }
+  return totals;
+}
+
+double Percentile(std::vector<double> &v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  auto idx = size_t(p * double(v.size() - 1) + 0.5);
+  return v[idx];
+}
+
+void PrintTotals(Totals &totals, const char *indent) {
+  double seconds = std::max(totals.seconds, 1e-9);
+  std::printf("%s\"streams\": %zu,\n", indent, totals.streams);
+  std::printf("%s\"frames\": %zu,\n", indent, totals.frames);
+  std::printf("%s\"seconds\": %.6f,\n", indent, totals.seconds);
+  std::printf("%s\"fps\": %.2f,\n", indent, double(totals.frames) / seconds);
+  std::printf("%s\"megapixels_per_second\": %.3f,\n", indent,
+              totals.pixels / seconds / 1e6);
+  std::printf("%s\"megabytes_per_second\": %.3f,\n", indent,
+              totals.bytes / seconds / 1e6);
+  std::printf("%s\"latency_us\": {\"p50\": %.2f, \"p99\": %.2f, \"max\": %.2f}",
+              indent, Percentile(totals.latencies, 0.5),
+              Percentile(totals.latencies, 0.99),
+              Percentile(totals.latencies, 1.0));
+}
+
+}  // namespace
+}  // namespace vp8_bench
+
+int main(int argc, const char **argv) {
+  using namespace vp8_bench;
+  ensure(argc <= 4, kUsage);
+  std::string dir = VectorDir(argc, argv);
+  size_t iterations = argc > 2 ? size_t(std::stoul(argv[2])) : 10;
+  size_t num_threads = argc > 3 ? size_t(std::stoul(argv[3])) : 1;
+  ensure(iterations > 0, kUsage);
+
+  std::vector<std::filesystem::path> files;
+  for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.is_regular_file() && entry.path().extension() == ".ivf")
+      files.push_back(entry.path());
+  }
+  std::sort(files.begin(), files.end());
+  ensure(!files.empty(), "[Error] decode_bench: No .ivf file in " + dir);
+
+  // Ordered so that the output is stable from one run to the next.
+  std::map<std::string, Totals> categories;
+  Totals all;
+  for (const auto &file : files) {
+    std::string name = file.filename().string();
+    Totals totals = DecodeStream(file.string(), iterations, num_threads);
+    categories[Category(name)].Add(totals);
+    all.Add(totals);
+  }
+
+  std::printf("{\n");
+  std::printf("  \"iterations\": %zu,\n", iterations);
+  std::printf("  \"threads\": %zu,\n", num_threads);
+  std::printf("  \"categories\": {\n");
+  for (auto it = categories.begin(); it != categories.end(); ++it) {
+    std::printf("    \"%s\": {\n", it->first.c_str());
+    PrintTotals(it->second, "      ");
+    std::printf("\n    }%s\n", std::next(it) == categories.end() ? "" : ",");
+  }
+  std::printf("  },\n");
+  std::printf("  \"total\": {\n");
+  PrintTotals(all, "    ");
+  std::printf("\n  }\n");
+  std::printf("}\n");
+  return 0;
+}
@@ -0,0 +1,410 @@
+#include <array>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../src/bitstream_const.h"
+#include "../src/bitstream_parser.h"
+#include "../src/bool_decoder.h"
+#include "../src/dct.h"
+#include "../src/decode_frame.h"
+#include "../src/dsp.h"
+#include "../src/filter.h"
+#include "../src/frame.h"
+#include "../src/inter_predict.h"
+#include "../src/intra_predict.h"
+#include "../src/ivf.h"
+#include "../src/utils.h"
+#include "../src/vp8.h"
+#include "../src/yuv.h"
+#include "bench.h"
+
+namespace vp8_bench {
+namespace {
+
+// A single-partition intra stream for the bool decoder and a 352x288 inter
+// stream for the tokens (its key frame mixes 16x16 and subblock modes, hence
+// Y2 blocks) and the pixel kernels.
+constexpr char kIntraVector[] = "vp80-01-intra-1400.ivf";
+constexpr char kInterVector[] = "vp80-05-sharpness-1438.ivf";
+
+using Block = std::array<std::array<int16_t, 4>, 4>;
+
+// The first frame of a stream (a key frame), along with its first partition
+// (the modes) and the size of its DCT token partitions.
+struct KeyFrameData {
+  std::vector<uint8_t> payload, modes;
+  size_t token_bytes;
+};
+
+KeyFrameData LoadKeyFrame(const std::string &path) {
+  vp8::IvfReader ivf(path.c_str());
+  ensure(ivf.size() > 0, "[Error] LoadKeyFrame: Empty stream.");
+  vp8::SpanReader<uint8_t> payload = ivf.Payload(0);
+  const uint8_t *data = payload.cursor();
+  // A key frame starts with the 3-byte frame tag, the start code and the
+  // dimensions.
+  constexpr size_t kHeaderSize = 10;
+  ensure(payload.size() > kHeaderSize && !(data[0] & 1),
+         "[Error] LoadKeyFrame: Not a key frame.");
+  uint32_t first_part_size =
+      (uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16) >>
+      5;
+  ensure(kHeaderSize + first_part_size < payload.size(),
+         "[Error] LoadKeyFrame: Truncated frame.");
+
+  KeyFrameData res;
+  res.payload.assign(data, data + payload.size());
+  res.modes.assign(data + kHeaderSize, data + kHeaderSize + first_part_size);
+  res.token_bytes = payload.size() - kHeaderSize - first_part_size;
+  return res;
+}
+
+// The last shown frame of a stream, with its borders extended like a
+// reference frame.
+std::shared_ptr<vp8::Frame> LoadFrame(const std::string &path) {
+  vp8::IvfReader ivf(path.c_str());
+  vp8::Decoder decoder;
+  std::optional<vp8::FrameView> view;
+  for (size_t i = 0; i < ivf.size(); ++i) {
+    vp8::SpanReader<uint8_t> payload = ivf.Payload(i);
+    std::optional<vp8::FrameView> frame =
+        decoder.Decode(payload.cursor(), payload.size());
+    if (frame) view = frame;
+  }
+  ensure(view.has_value(), "[Error] LoadFrame: No frame is shown.");
+
+  auto frame = std::make_shared<vp8::Frame>(view->height, view->width);
+  size_t vsize = (view->height + 1) >> 1, hsize = (view->width + 1) >> 1;
+  for (size_t r = 0; r < view->height; ++r)
+    std::memcpy(frame->Y.Row(r), view->planes[0] + r * view->strides[0],
+                view->width);
+  for (size_t r = 0; r < vsize; ++r) {
+    std::memcpy(frame->U.Row(r), view->planes[1] + r * view->strides[1], hsize);
+    std::memcpy(frame->V.Row(r), view->planes[2] + r * view->strides[2], hsize);
+  }
+  frame->ExtendBorders();
+  return frame;
+}
+
+// The number of values draw(bd, i) reads from a BoolDecoder over data before
+// the first one depending on what follows the data (which the decoder reads as
+// zeros): the values a decoder over the same data padded with ones disagrees
+// on.
+template <class Draw>
+size_t DrawsWithinData(const std::vector<uint8_t> &data, Draw &&draw) {
+  std::vector<uint8_t> padded(data);
+  padded.resize(data.size() + 64, 0xFF);
+  vp8::BoolDecoder bd(
+      vp8::SpanReader<uint8_t>(data.data(), data.data() + data.size()));
+  vp8::BoolDecoder bd_padded(
+      vp8::SpanReader<uint8_t>(padded.data(), padded.data() + padded.size()));
+  size_t n = 0;
+  while (draw(bd, n) == draw(bd_padded, n)) ++n;
+  return n;
+}
+
+void BenchBoolDecoder(Runner &runner, const KeyFrameData &kf) {
+  const vp8::SpanReader<uint8_t> modes(kf.modes.data(),
+                                       kf.modes.data() + kf.modes.size());
+  auto draw_bool = [](vp8::BoolDecoder &bd, size_t i) {
+    return bd.Bool(vp8::kBModeProb[i % vp8::kBModeProb.size()]);
+  };
+  const size_t num_bools = DrawsWithinData(kf.modes, draw_bool);
+  runner.Run("BoolDecoder::Bool", num_bools, 0, [&] {
+    vp8::BoolDecoder bd(modes);
+    unsigned sum = 0;
+    for (size_t i = 0; i < num_bools; ++i)
+      sum += bd.Bool(vp8::kBModeProb[i % vp8::kBModeProb.size()]);
+    DoNotOptimize(sum);
+  });
+
+  auto draw_tree = [](vp8::BoolDecoder &bd, size_t) {
+    return bd.Tree(vp8::kBModeProb, vp8::kSubBlockModeTree);
+  };
+  const size_t num_trees = DrawsWithinData(kf.modes, draw_tree);
+  runner.Run("BoolDecoder::Tree", num_trees, 0, [&] {
+    vp8::BoolDecoder bd(modes);
+    unsigned sum = 0;
+    for (size_t i = 0; i < num_trees; ++i)
+      sum += bd.Tree(vp8::kBModeProb, vp8::kSubBlockModeTree);
+    DoNotOptimize(sum);
+  });
+}
+
+void BenchTokens(Runner &runner, const KeyFrameData &kf) {
+  // Parse the frame header (and its coefficient probability updates) and the
+  // modes like the decoder does, then keep the parser as it is before the
+  // first macroblock of the token partitions so that they can be read again.
+  vp8::ParserContext ctx;
+  auto ps = std::make_unique<vp8::BitstreamParser>(
+      vp8::SpanReader<uint8_t>(kf.payload.data(),
+                               kf.payload.data() + kf.payload.size()),
+      ctx);
+  vp8::FrameTag tag;
+  vp8::FrameHeader header;
+  std::tie(tag, header) = ps->ReadFrameTagHeader();
+  auto frame = std::make_shared<vp8::Frame>(tag.height, tag.width);
+  const size_t rows = frame->vblock, cols = frame->hblock;
+  std::vector<std::vector<uint8_t>> skip_lf(rows,
+                                            std::vector<uint8_t>(cols, 1));
+  std::vector<vp8::internal::MacroBlockInfo> info;
+  vp8::internal::ReadModes<true>(tag, {}, skip_lf, ps, frame, info);
+  const vp8::BitstreamParser tokens_start = *ps;
+
+  // Read each macroblock once with the non-zero contexts of the decoder,
+  // keeping the contexts and the blocks read.
+  std::vector<uint8_t> y2_row(rows), y2_col(cols);
+  std::vector<std::vector<uint8_t>> y1_nonzero(
+      rows << 2, std::vector<uint8_t>(cols << 2));
+  std::vector<std::vector<uint8_t>> u_nonzero(
+      rows << 1, std::vector<uint8_t>(cols << 1));
+  std::vector<std::vector<uint8_t>> v_nonzero(
+      rows << 1, std::vector<uint8_t>(cols << 1));
+  std::vector<vp8::ResidualParam> params;
+  std::vector<Block> blocks, y2_blocks;
+  vp8::ResidualData rd;
+  for (size_t r = 0; r < rows; ++r) {
+    for (size_t c = 0; c < cols; ++c) {
+      params.push_back(vp8::internal::NonzeroContext(
+          r, c, y2_row, y2_col, y1_nonzero, u_nonzero, v_nonzero));
+      ps->ReadResidualData(r, c, params.back(), rd);
+      vp8::internal::UpdateNonzero(rd, r, c, y2_row, y2_col, y1_nonzero,
+                                   u_nonzero, v_nonzero);
+      if (info.at(r * cols + c).pre.mb_skip_coeff) continue;
+      for (size_t i = rd.has_y2 ? 0 : 1; i < 25; ++i) {
+        Block block;
+        for (size_t k = 0; k < 16; ++k)
+          block[k >> 2][k & 3] = rd.dct_coeff.at(i).at(k);
+        (i == 0 ? y2_blocks : blocks).push_back(block);
+      }
+    }
+  }
+
+  // BitstreamParser::ReadResidualData reads each block of a macroblock with
+  // ReadTokens, the coefficient probabilities of the frame and the contexts.
+  const size_t num_blocks = blocks.size() + y2_blocks.size();
+  runner.Run("ReadResidualData", num_blocks,
+             double(kf.token_bytes) / double(num_blocks), [&] {
+               vp8::BitstreamParser parser = tokens_start;
+               for (size_t r = 0; r < rows; ++r) {
+                 for (size_t c = 0; c < cols; ++c)
+                   parser.ReadResidualData(r, c, params[r * cols + c], rd);
+               }
+               DoNotOptimize(rd);
+             });
+  // Dequantized with mid-range factors and added to a 4x4 block of pixels,
+  // always through the full transform.
+  std::array<uint8_t, 16> pixels{};
+  runner.Run("DequantIDCTAdd", blocks.size(), 0, [&] {
+    for (const Block &block : blocks)
+      vp8::internal::Dsp().dequant_idct_add(block.at(0).data(), 40, 60, 16,
+                                            pixels.data(), 4);
+    DoNotOptimize(pixels);
+  });
+  runner.Run("IWHT", y2_blocks.size(), 0, [&] {
+    for (const Block &block : y2_blocks) {
+      Block tmp = block;
+      vp8::IWHT(tmp);
+      DoNotOptimize(tmp);
+    }
+  });
+}
+
+void BenchInterPredict(Runner &runner, const vp8::Frame &ref) {
+  static std::mt19937 kRng(7122);
+  vp8::Frame out(ref.vsize, ref.hsize);
+
+  // Subblocks anywhere in the picture with a fractional motion vector in both
+  // directions, the case taking both sixtap passes.
+  struct SixtapInput {
+    int32_t r, c;
+    uint8_t mr, mc;
+  };
+  constexpr size_t kNumSubBlocks = 4096;
+  std::vector<SixtapInput> inputs;
+  std::uniform_int_distribution<int32_t> row(0, int32_t(ref.Y.vsize()) - 4);
+  std::uniform_int_distribution<int32_t> col(0, int32_t(ref.Y.hsize()) - 4);
+  std::uniform_int_distribution<int> frac(1, 7);
+  for (size_t i = 0; i < kNumSubBlocks; ++i)
+    inputs.push_back(
+        {row(kRng), col(kRng), uint8_t(frac(kRng)), uint8_t(frac(kRng))});
+  vp8::SubBlock sub = out.Y.at(0, 0).at(0, 0);
+  runner.Run("Sixtap<4>", inputs.size(), 16, [&] {
+    for (const SixtapInput &in : inputs)
+      vp8::internal::Sixtap(ref.Y, in.r, in.c, in.mr, in.mc,
+                            vp8::kBicubicFilter, sub);
+    ClobberMemory();
+  });
+
+  // One motion vector per macroblock, up to 16 pixels in each direction.
+  std::uniform_int_distribution<int16_t> mv(-128, 128);
+  std::vector<std::array<vp8::MotionVector, 16>> luma_mvs;
+  std::vector<std::array<vp8::MotionVector, 4>> chroma_mvs;
+  for (size_t i = 0; i < ref.vblock * ref.hblock; ++i) {
+    vp8::MotionVector v(mv(kRng), mv(kRng));
+    luma_mvs.emplace_back();
+    luma_mvs.back().fill(v);
+    chroma_mvs.emplace_back();
+    chroma_mvs.back().fill(v);
+  }
+  const size_t num_macroblocks = ref.vblock * ref.hblock;
+  // The sixtap filters of version 0 and the bilinear ones of the others.
+  for (uint8_t version : {0, 1}) {
+    vp8::FrameTag tag{};
+    tag.version = version;
+    const vp8::Interpolation interp(tag);
+    std::string suffix = version == 0 ? "" : " bilinear";
+    runner.Run("InterpBlock<4>" + suffix, num_macroblocks, 256, [&] {
+      for (size_t r = 0, i = 0; r < ref.vblock; ++r) {
+        for (size_t c = 0; c < ref.hblock; ++c, ++i)
+          vp8::internal::InterpBlock(ref.Y, interp, r, c, luma_mvs[i].data(),
+                                     out.Y.at(r, c));
+      }
+      ClobberMemory();
+    });
+    runner.Run("InterpBlock<2>" + suffix, num_macroblocks, 64, [&] {
+      for (size_t r = 0, i = 0; r < ref.vblock; ++r) {
+        for (size_t c = 0; c < ref.hblock; ++c, ++i)
+          vp8::internal::InterpBlock(ref.U, interp, r, c, chroma_mvs[i].data(),
+                                     out.U.at(r, c));
+      }
+      ClobberMemory();
+    });
+  }
+}
+
+void BenchIntraPredict(Runner &runner, const std::shared_ptr<vp8::Frame> &ref) {
+  struct Edges {
+    std::array<uint8_t, 8> above;
+    std::array<uint8_t, 4> left;
+    uint8_t p;
+    vp8::SubBlockMode mode;
+  };
+  std::vector<Edges> inputs;
+  for (size_t r = 0; r < ref->vblock; ++r) {
+    for (size_t c = 0; c < ref->hblock; ++c) {
+      for (size_t i = 0; i < 16; ++i) {
+        Edges e{};
+        vp8::internal::BPredEdges(r, c, i >> 2, i & 3, ref->Y, e.above, e.left,
+                                  e.p);
+        e.mode = vp8::SubBlockMode(inputs.size() % vp8::kNumIntraBModes);
+        inputs.push_back(e);
+      }
+    }
+  }
+  vp8::Frame out(16, 16);
+  vp8::SubBlock sub = out.Y.at(0, 0).at(0, 0);
+  runner.Run("BPredSubBlock", inputs.size(), 16, [&] {
+    for (const Edges &e : inputs)
+      vp8::internal::BPredSubBlock(e.above, e.left, e.p, e.mode, sub);
+    ClobberMemory();
+  });
+
+  // The predictors of the decoder, in place, the modes taking turns. The
+  // pixels they start from do not matter.
+  vp8::Frame frame(ref->vsize, ref->hsize);
+  vp8::internal::InitIntraEdges(frame);
+  const size_t num_macroblocks = frame.vblock * frame.hblock;
+  using namespace vp8::internal;
+  const std::array<void (*)(size_t, size_t, vp8::Plane<4> &), 4> luma = {
+      DCPredLuma, VPredLuma, HPredLuma, TMPredLuma};
+  const std::array<void (*)(size_t, size_t, vp8::Plane<2> &), 4> chroma = {
+      DCPredChroma, VPredChroma, HPredChroma, TMPredChroma};
+  runner.Run("IntraPredict<4>", num_macroblocks, 256, [&] {
+    for (size_t r = 0; r < frame.vblock; ++r) {
+      for (size_t c = 0; c < frame.hblock; ++c)
+        luma.at((r + c) & 3)(r, c, frame.Y);
+    }
+    ClobberMemory();
+  });
+  runner.Run("IntraPredict<2>", num_macroblocks, 64, [&] {
+    for (size_t r = 0; r < frame.vblock; ++r) {
+      for (size_t c = 0; c < frame.hblock; ++c)
+        chroma.at((r + c) & 3)(r, c, frame.U);
+    }
+    ClobberMemory();
+  });
+  // Without residual, so that only the prediction is measured.
+  vp8::MacroBlockResidual res{};
+  std::array<vp8::SubBlockMode, 16> sub_modes{};
+  for (size_t i = 0; i < 16; ++i)
+    sub_modes.at(i) = vp8::SubBlockMode(i % vp8::kNumIntraBModes);
+  runner.Run("BPredLuma", num_macroblocks, 256, [&] {
+    for (size_t r = 0; r < frame.vblock; ++r) {
+      for (size_t c = 0; c < frame.hblock; ++c)
+        BPredLuma(r, c, res, sub_modes, frame.Y);
+    }
+    ClobberMemory();
+  });
+}
+
+void BenchLoopFilter(Runner &runner, const std::string &path) {
+  // Filtering the same frame over and over keeps smoothing it, but the work
+  // done per edge does not depend much on the pixels.
+  std::shared_ptr<vp8::Frame> frame = LoadFrame(path);
+  vp8::FrameHeader header{};
+  header.loop_filter_level = 32;
+  header.sharpness_level = 0;
+  std::vector<std::vector<uint8_t>> lf(
+      frame->vblock, std::vector<uint8_t>(frame->hblock, 32));
+  std::vector<std::vector<uint8_t>> skip_lf(
+      frame->vblock, std::vector<uint8_t>(frame->hblock, 0));
+  const size_t num_macroblocks = frame->vblock * frame->hblock;
+
+  runner.Run("PlaneFilterNormal<4>", num_macroblocks, 256, [&] {
+    vp8::internal::PlaneFilterNormal(header, frame->hblock, 0, frame->vblock,
+                                     false, lf, skip_lf, frame->Y);
+  });
+  runner.Run("PlaneFilterNormal<2>", num_macroblocks, 64, [&] {
+    vp8::internal::PlaneFilterNormal(header, frame->hblock, 0, frame->vblock,
+                                     false, lf, skip_lf, frame->U);
+  });
+  // The filter actually used by the decoder, SIMD included.
+  runner.Run("FilterRows", num_macroblocks, 384, [&] {
+    vp8::FilterRows(header, false, lf, skip_lf, 0, frame->vblock, frame);
+  });
+}
+
+void BenchWriteFrame(Runner &runner, const std::string &path) {
+  vp8::IvfReader ivf(path.c_str());
+  vp8::Decoder decoder;
+  vp8::SpanReader<uint8_t> payload = ivf.Payload(0);
+  std::optional<vp8::FrameView> view =
+      decoder.Decode(payload.cursor(), payload.size());
+  ensure(view.has_value(), "[Error] BenchWriteFrame: No frame is shown.");
+
+  vp8::YUV<vp8::WRITE> yuv("/dev/null");
+  double bytes = double(view->width * view->height +
+                        2 * ((view->width + 1) >> 1) *
+                            ((view->height + 1) >> 1));
+  runner.Run("YUV<WRITE>::WriteFrame", 1, bytes,
+             [&] { yuv.WriteFrame(*view); });
+}
+
+}  // namespace
+}  // namespace vp8_bench
+
+int main(int argc, const char **argv) {
+  using namespace vp8_bench;
+  std::string dir = VectorDir(argc, argv);
+  KeyFrameData kf = LoadKeyFrame(dir + kIntraVector);
+  KeyFrameData inter_kf = LoadKeyFrame(dir + kInterVector);
+  std::shared_ptr<vp8::Frame> ref = LoadFrame(dir + kInterVector);
+
+  // The kernels of the level picked for a decoder (VP8_CPU_LEVEL included).
+  vp8::internal::InitDsp();
+  std::printf("kernels: %s\n", vp8::CpuLevelName(vp8::ActiveCpuLevel()));
+  Runner runner;
+  BenchBoolDecoder(runner, kf);
+  BenchTokens(runner, inter_kf);
+  BenchInterPredict(runner, *ref);
+  BenchIntraPredict(runner, ref);
+  BenchLoopFilter(runner, dir + kInterVector);
+  BenchWriteFrame(runner, dir + kInterVector);
+  return 0;
+}
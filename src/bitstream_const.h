@@ -2,6 +2,7 @@
 #define BITSTREAM_CONST_H_
 
 #include <array>
+#include <cstdint>
 #include <vector>
 
 namespace vp8 {
@@ -36,7 +37,7 @@ enum RefFrame {
   kNumRefFrames
 };
 
-enum MacroBlockMode {
+enum MacroBlockMode : uint8_t {
   DC_PRED,
   V_PRED,
   H_PRED,
@@ -56,7 +57,7 @@ enum MacroBlockMV {
   kNumMVRefs = MV_SPLIT + 1 - MV_NEAREST
 };
 
-enum SubBlockMode {
+enum SubBlockMode : uint8_t {
   B_DC_PRED,
   B_TM_PRED,
   B_VE_PRED,
@@ -21,12 +21,12 @@ FrameTag BitstreamParser::ReadFrameTag() {
   frame_tag_.version = (tag >> 1) & 0x7;
   frame_tag_.show_frame = (tag >> 4) & 0x1;
   first_part_size_ = (tag >> 5) & 0x7FFFF;
-  ensure(!(frame_tag_.version >> 2),
-         "[Error] ReadFrameTag: Experimental streams unsupported.");
+  check(!(frame_tag_.version >> 2),
+        "[Error] ReadFrameTag: Experimental streams unsupported.");
   if (frame_tag_.key_frame) {
     uint32_t start_code = buffer_.ReadBytes(3);
-    ensure(start_code == 0x2A019D,
-           "[Error] ReadFrameTag: Incorrect start_code.");
+    check(start_code == 0x2A019D,
+          "[Error] ReadFrameTag: Incorrect start_code.");
     uint32_t horizontal_size_code = buffer_.ReadBytes(2);
     frame_tag_.width = horizontal_size_code & 0x3FFF;
     frame_tag_.horizontal_scale = uint16_t(horizontal_size_code >> 14);
@@ -44,8 +44,8 @@ FrameHeader BitstreamParser::ReadFrameHeader() {
     context_.get() = ParserContext();
     frame_header_.color_space = bd_.LitU8(1);
     frame_header_.clamping_type = bd_.LitU8(1);
-    ensure(!frame_header_.color_space && !frame_header_.clamping_type,
-           "[Error] ReadFrameHeader: Unsupported color_space / clamping_type");
+    check(!frame_header_.color_space && !frame_header_.clamping_type,
+          "[Error] ReadFrameHeader: Unsupported color_space / clamping_type");
     context_.get().mb_num_cols = (frame_tag_.width + 15) / 16;
     context_.get().mb_num_rows = (frame_tag_.height + 15) / 16;
     context_.get().mb_metadata.resize(uint32_t(context_.get().mb_num_cols) *
@@ -75,14 +75,18 @@ FrameHeader BitstreamParser::ReadFrameHeader() {
                                    3 * (nbr_of_dct_partitions_ - 1));
   size_t offset =
       tag_size + first_part_size_ + 3 * (nbr_of_dct_partitions_ - 1);
+  partition_size_.fill(0);
   for (size_t i = 0; i < nbr_of_dct_partitions_ - 1; i++) {
     auto count = size_span.ReadBytes(3);
     residual_bd_.at(i) = BoolDecoder(buffer_.SubSpan(offset, count));
+    partition_size_.at(i) = count;
     offset += count;
   }
   if (buffer_.size() - offset >= 2) {
     residual_bd_.at(nbr_of_dct_partitions_ - 1) =
         BoolDecoder(buffer_.SubSpan(offset));
+    partition_size_.at(nbr_of_dct_partitions_ - 1) =
+        uint32_t(buffer_.size() - offset);
   }
   frame_header_.quant_indices = ReadQuantIndices();
   if (frame_tag_.key_frame) {
@@ -463,38 +467,28 @@ int16_t BitstreamParser::ReadMVComponent(bool kind) {
   return a;
 }
 
-ResidualData BitstreamParser::ReadResidualData(
-    const ResidualParam &residual_ctx) {
-  if (mb_cur_col_ == context_.get().mb_num_cols) {
-    mb_cur_row_++;
-    mb_cur_col_ = 0;
-    if (nbr_of_dct_partitions_ > 1) {
-      cur_partition_++;
-      if (cur_partition_ == nbr_of_dct_partitions_) {
-        cur_partition_ = 0;
-      }
-    }
-  }
-  mb_cur_col_++;
-  ensure(
-      mb_cur_row_ < context_.get().mb_num_rows,
-      "[Error] ReadResidualData: Consumed too many macroblocks; vomiting...");
-  ensure(residual_macroblock_idx_ < macroblock_metadata_idx_,
-         "[Error] ReadResidualData: Corresponding macroblock not yet read.");
-  ResidualData result{};
-  auto macroblock_metadata =
-      context_.get().mb_metadata.at(residual_macroblock_idx_);
+void BitstreamParser::ReadResidualData(size_t r, size_t c,
+                                       const ResidualParam &residual_ctx,
+                                       ResidualData &result) {
+  check(r < context_.get().mb_num_rows && c < context_.get().mb_num_cols,
+        "[Error] ReadResidualData: Macroblock out of range.");
+  size_t idx = r * context_.get().mb_num_cols + c;
+  check(idx < macroblock_metadata_idx_,
+        "[Error] ReadResidualData: Corresponding macroblock not yet read.");
+  BoolDecoder &bd = residual_bd_.at(r % nbr_of_dct_partitions_);
+  // The tokens only write the non-zero coefficients.
+  result.dct_coeff = {};
+  result.eob = {};
+  auto macroblock_metadata = context_.get().mb_metadata.at(idx);
   auto first_coeff = (macroblock_metadata & 0x1) ? 1 : 0;
   result.has_y2 = first_coeff;
-  residual_macroblock_idx_++;
   if (!((macroblock_metadata >> 1) & 0x1)) {
     // std::array<bool, 25> non_zero{};
     uint32_t non_zero = 0;
     if (macroblock_metadata & 0x1) {
-      bool p = false;
-      tie(result.dct_coeff.at(0), p) =
-          ReadResidualBlock(1, residual_ctx.y2_nonzero);
-      if (p) non_zero |= 1;
+      result.eob.at(0) = ReadResidualBlock(bd, 1, residual_ctx.y2_nonzero,
+                                           result.dct_coeff.at(0));
+      if (result.eob.at(0)) non_zero |= 1;
     }
     unsigned block_type_y = first_coeff ? 0 : 3;
     for (unsigned i = 1; i <= 16; i++) {
@@ -503,10 +497,10 @@ ResidualData BitstreamParser::ReadResidualData(
       unsigned left_nonzero =
           ((i - 1) & 3) ? (non_zero >> (i - 1)) & 1
                         : (residual_ctx.y1_left >> ((i - 1) >> 2)) & 1;
-      bool p = false;
-      std::tie(result.dct_coeff.at(i), p) =
-          ReadResidualBlock(block_type_y, above_nonzero + left_nonzero);
-      if (p) non_zero |= (1 << i);
+      result.eob.at(i) =
+          ReadResidualBlock(bd, block_type_y, above_nonzero + left_nonzero,
+                            result.dct_coeff.at(i));
+      if (result.eob.at(i)) non_zero |= (1 << i);
     }
     for (unsigned i = 17; i <= 20; i++) {
       unsigned above_nonzero = (i <= 18)
@@ -515,10 +509,9 @@ ResidualData BitstreamParser::ReadResidualData(
       unsigned left_nonzero =
           ((i - 17) & 1) ? (non_zero >> (i - 1)) & 1
                          : (residual_ctx.u_left >> ((i - 17) >> 1)) & 1;
-      bool p = false;
-      std::tie(result.dct_coeff.at(i), p) =
-          ReadResidualBlock(2, above_nonzero + left_nonzero);
-      if (p) non_zero |= (1 << i);
+      result.eob.at(i) = ReadResidualBlock(
+          bd, 2, above_nonzero + left_nonzero, result.dct_coeff.at(i));
+      if (result.eob.at(i)) non_zero |= (1 << i);
     }
     for (unsigned i = 21; i <= 24; i++) {
       unsigned above_nonzero = (i <= 22)
@@ -527,10 +520,9 @@ ResidualData BitstreamParser::ReadResidualData(
       unsigned left_nonzero =
           ((i - 21) & 1) ? (non_zero >> (i - 1)) & 1
                          : (residual_ctx.v_left >> ((i - 21) >> 1)) & 1;
-      bool p = false;
-      std::tie(result.dct_coeff.at(i), p) =
-          ReadResidualBlock(2, above_nonzero + left_nonzero);
-      if (p) non_zero |= (1 << i);
+      result.eob.at(i) = ReadResidualBlock(
+          bd, 2, above_nonzero + left_nonzero, result.dct_coeff.at(i));
+      if (result.eob.at(i)) non_zero |= (1 << i);
     }
     result.is_zero = non_zero == 0;
   } else {
@@ -566,58 +558,13 @@ ResidualData BitstreamParser::ReadResidualData(
     loop_filter_level = std::clamp(loop_filter_level, 0, 63);
   }
   result.loop_filter_level = uint8_t(loop_filter_level);
-  return result;
 }
 
-std::pair<std::array<int16_t, 16>, bool> BitstreamParser::ReadResidualBlock(
-    unsigned block_type, unsigned zero_cnt) {
-  std::array<int16_t, 16> result{};
-  bool non_zero = false;
-  bool last_zero = false;
-  unsigned ctx3 = zero_cnt;
-  for (unsigned n = (block_type == 0 ? 1 : 0); n < 16; n++) {
-    unsigned i = kZigZag.at(n);
-    auto &prob = context_.get()
-                     .coeff_prob.get()
-                     .at(block_type)
-                     .at(kCoeffBands.at(n))
-                     .at(ctx3);
-    DctToken token;
-    if (last_zero) {
-      auto prob_no_eob =
-          IteratorArray<std::remove_reference<decltype(prob)>::type>(
-              prob.begin() + 1, prob.end());
-      token = DctToken(
-          residual_bd_.at(cur_partition_).Tree(prob_no_eob, kCoeffTreeNoEOB));
-    } else {
-      token = DctToken(residual_bd_.at(cur_partition_).Tree(prob, kCoeffTree));
-    }
-    if (token == DCT_EOB) {
-      break;
-    }
-    result.at(i) = kTokenToCoeff.at(token);
-    if (result.at(i) != DCT_0) {
-      non_zero = true;
-      last_zero = false;
-      if (token >= DCT_CAT1) {
-        size_t idx = size_t(token - DCT_CAT1);
-        unsigned v = 0;
-        for (unsigned j = 0; kPcat.at(idx).at(j); j++) {
-          v += v + residual_bd_.at(cur_partition_).Bool(kPcat.at(idx).at(j));
-        }
-        result.at(i) += uint16_t(v);
-      }
-      ctx3 = result.at(i) > 1 ? 2 : unsigned(result.at(i));
-      bool sign = residual_bd_.at(cur_partition_).LitU8(1);
-      if (sign) {
-        result.at(i) = -result.at(i);
-      }
-    } else {
-      last_zero = true;
-      ctx3 = 0;
-    }
-  }
-  return make_pair(result, non_zero);
+uint8_t BitstreamParser::ReadResidualBlock(BoolDecoder &bd,
+                                           unsigned block_type, unsigned ctx,
+                                           std::array<int16_t, 16> &coeffs) {
+  return ReadTokens(bd, context_.get().coeff_prob.get().at(block_type),
+                    block_type == 0 ? 1 : 0, ctx, coeffs);
 }
 
 }  // namespace vp8
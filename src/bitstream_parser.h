@@ -10,6 +10,7 @@
 #include "bitstream_const.h"
 #include "bool_decoder.h"
 #include "frame.h"
+#include "token_reader.h"
 #include "utils.h"
 
 namespace vp8 {
@@ -112,10 +113,16 @@ struct InterMBHeader {
 
 struct IntraMBHeader {
   MacroBlockMode intra_y_mode;
+  // Filled by ReadIntraModes() once the subblock and chroma modes are read.
+  MacroBlockMode intra_uv_mode;
+  std::array<SubBlockMode, 16> sub_modes;
 };
 
 struct ResidualData {
   std::array<std::array<int16_t, 16>, 25> dct_coeff;
+  // One past the zigzag position of the last non-zero coefficient of each
+  // block, 0 if the block is all zero.
+  std::array<uint8_t, 25> eob;
   uint8_t segment_id;
   uint8_t loop_filter_level;
   bool has_y2, is_zero;
@@ -207,11 +214,11 @@ class BitstreamParser {
   FrameTag frame_tag_;
   FrameHeader frame_header_;
   std::reference_wrapper<ParserContext> context_;
-  size_t macroblock_metadata_idx_, residual_macroblock_idx_;
-  uint8_t nbr_of_dct_partitions_, cur_partition_;
-  uint16_t mb_cur_row_, mb_cur_col_;
+  size_t macroblock_metadata_idx_;
+  uint8_t nbr_of_dct_partitions_;
   uint32_t first_part_size_;
   std::array<BoolDecoder, 8> residual_bd_;
+  std::array<uint32_t, 8> partition_size_;
   bool loop_filter_adj_enable_;
 
   FrameHeader ReadFrameHeader();
@@ -226,8 +233,9 @@ class BitstreamParser {
 
   void MVProbUpdate();
 
-  std::pair<std::array<int16_t, 16>, bool> ReadResidualBlock(
-      unsigned block_type, unsigned zero_cnt);
+  // Returns the end-of-block position of the block (see ReadTokens).
+  uint8_t ReadResidualBlock(BoolDecoder& bd, unsigned block_type,
+                            unsigned ctx, std::array<int16_t, 16>& coeffs);
 
   int16_t ReadMVComponent(bool kind);
 
@@ -239,12 +247,9 @@ class BitstreamParser {
         frame_header_(),
         context_(std::ref(ctx)),
         macroblock_metadata_idx_(),
-        residual_macroblock_idx_(),
         nbr_of_dct_partitions_(),
-        cur_partition_(),
-        mb_cur_row_(),
-        mb_cur_col_(),
         first_part_size_(),
+        partition_size_(),
         loop_filter_adj_enable_() {}
 
   std::pair<FrameTag, FrameHeader> ReadFrameTagHeader();
@@ -269,7 +274,19 @@ class BitstreamParser {
 
   IntraMBHeader ReadIntraMBHeaderNonKF();
 
-  ResidualData ReadResidualData(const ResidualParam& residual_ctx);
+  // Read the residual data of macroblock (r, c) from DCT partition
+  // r % num_partitions() into result, which is overwritten in place rather
+  // than returned. The modes of the macroblock must have been read.
+  // Macroblocks in different partitions may be read concurrently, while those
+  // sharing a partition must be read in raster-scan order.
+  void ReadResidualData(size_t r, size_t c, const ResidualParam& residual_ctx,
+                        ResidualData& result);
+
+  uint8_t num_partitions() const { return nbr_of_dct_partitions_; }
+
+  // The sizes in bytes of the first partition and of each DCT partition.
+  uint32_t first_part_size() const { return first_part_size_; }
+  uint32_t partition_size(size_t idx) const { return partition_size_.at(idx); }
 
   FrameTag ReadFrameTag();
 
@@ -1,43 +1,28 @@
 #include "bool_decoder.h"
 
-namespace vp8 {
+#include <cstring>
 
-void BoolDecoder::Init() {
-  uint8_t byte1 = sp_.ReadByte();
-  uint8_t byte2 = sp_.ReadByte();
-  value_ = uint32_t(byte1) << 8 | uint32_t(byte2);
-  range_ = 255;
-  bit_count_ = 0;
-}
+namespace vp8 {
 
-uint8_t BoolDecoder::Bool(uint8_t prob) {
-  if (!has_init_) {
-    Init();
-    has_init_ = true;
+void BoolDecoder::Fill() {
+  // The bit position where the next byte goes.
+  int shift = kValueBits - 8 - (count_ + 8);
+  if (end_ - cursor_ >= 8) {
+    uint64_t word = 0;
+    std::memcpy(&word, cursor_, sizeof(word));
+    word = __builtin_bswap64(word);
+    int bytes = (shift >> 3) + 1;
+    value_ |= (word >> (kValueBits - 8 * bytes)) << (shift & 7);
+    cursor_ += bytes;
+    count_ += 8 * bytes;
+    return;
   }
-  uint32_t split = 1 + (((range_ - 1) * prob) >> 8);
-  uint8_t res = 0;
-  if (value_ >= (split << 8)) {
-    res = 1;
-    assert(split <= range_);
-    assert((split << 8) <= value_);
-    range_ -= split;
-    value_ -= (split << 8);
-  } else {
-    res = 0;
-    range_ = split;
+  while (shift >= 0 && cursor_ < end_) {
+    value_ |= uint64_t(*cursor_++) << shift;
+    count_ += 8;
+    shift -= 8;
   }
-
-  while (range_ < 128) {
-    value_ <<= 1;
-    range_ <<= 1;
-    if (++bit_count_ == 8) {
-      bit_count_ = 0;
-      uint8_t byte = sp_.ReadByte();
-      value_ |= byte;
-    }
-  }
-  return res;
+  if (shift >= 0) count_ += kLotsOfBits;
 }
 
 uint16_t BoolDecoder::Lit(size_t n) {
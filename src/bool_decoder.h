@@ -15,11 +15,37 @@ namespace vp8 {
 
 class BoolDecoder {
  public:
-  BoolDecoder() = default;
-  explicit BoolDecoder(SpanReader<uint8_t> sp) : sp_(sp), has_init_(false) {}
+  BoolDecoder() : BoolDecoder(SpanReader<uint8_t>()) {}
+  explicit BoolDecoder(SpanReader<uint8_t> sp)
+      : value_(0),
+        range_(255),
+        count_(-8),
+        cursor_(sp.cursor()),
+        end_(sp.end()) {
+    Fill();
+  }
 
   // Decode a 1-bit boolean value.
-  uint8_t Bool(uint8_t prob);
+  inline uint8_t Bool(uint8_t prob) {
+    if (count_ < 0) Fill();
+    uint32_t split = 1 + (((range_ - 1) * prob) >> 8);
+    uint64_t big_split = uint64_t(split) << (kValueBits - 8);
+    uint8_t res = 0;
+    if (value_ >= big_split) {
+      res = 1;
+      range_ -= split;
+      value_ -= big_split;
+    } else {
+      range_ = split;
+    }
+    // Shift range_ back into [128, 255] in one step. range_ is never zero, and
+    // it fits in the lowest byte, hence the 24 leading zeros to discount.
+    int shift = __builtin_clz(range_) - 24;
+    range_ <<= shift;
+    value_ <<= shift;
+    count_ -= shift;
+    return res;
+  }
   // Decode an unsigned n-bit literal.
   uint16_t Lit(size_t n);
   uint8_t LitU8(size_t n) { return uint8_t(Lit(n)); }
@@ -41,14 +67,20 @@ class BoolDecoder {
   }
 
  private:
-  uint32_t value_;
+  static constexpr int kValueBits = 64;
+  // Once the data is exhausted, pretend that this many zero bits are available
+  // so that reading past the end behaves like reading zero bytes.
+  static constexpr int kLotsOfBits = 0x4000;
+
+  // The top 8 bits of value_ are compared against the split; the count_ bits
+  // below them are already loaded from the stream.
+  uint64_t value_;
   uint32_t range_;
-  uint8_t bit_count_;
-  SpanReader<uint8_t> sp_;
+  int count_;
+  const uint8_t *cursor_, *end_;
 
-  // Prepare the Boolean decoder to decode probability encoded data.
-  void Init();
-  bool has_init_;
+  // Load as many whole bytes as fit in value_.
+  void Fill();
 };
 
 }  // namespace vp8
@@ -106,6 +106,58 @@ void IDCT(std::array<std::array<int16_t, 4>, 4> &subblock) {
   }
 }
 
+void IDCTRowCol(std::array<std::array<int16_t, 4>, 4> &subblock) {
+  static const int cospi8_sqrt2_minus1 = 20091;
+  static const int sinpi8_sqrt2 = 35468;
+  // First pass: only the first column has more than its first coefficient,
+  // the other columns are copied down unchanged.
+  std::array<int16_t, 4> col;
+  {
+    int a = int(subblock[0][0]) + int(subblock[2][0]);
+    int b = int(subblock[0][0]) - int(subblock[2][0]);
+
+    int tmp1 = (int(subblock[1][0]) * sinpi8_sqrt2) >> 16;
+    int tmp2 = int(subblock[3][0]) +
+               ((int(subblock[3][0]) * cospi8_sqrt2_minus1) >> 16);
+    int c = tmp1 - tmp2;
+    tmp1 = int(subblock[1][0]) +
+           ((int(subblock[1][0]) * cospi8_sqrt2_minus1) >> 16);
+    tmp2 = (int(subblock[3][0]) * sinpi8_sqrt2) >> 16;
+    int d = tmp1 + tmp2;
+
+    col[0] = int16_t(a + d);
+    col[3] = int16_t(a - d);
+    col[1] = int16_t(b + c);
+    col[2] = int16_t(b - c);
+  }
+
+  // Second pass: every row is (col[i], x1, x2, x3) with the x of the first
+  // row, so c and d are the same for all of them.
+  int x2 = subblock[0][2];
+  int tmp1 = (int(subblock[0][1]) * sinpi8_sqrt2) >> 16;
+  int tmp2 = int(subblock[0][3]) +
+             ((int(subblock[0][3]) * cospi8_sqrt2_minus1) >> 16);
+  int c = tmp1 - tmp2;
+  tmp1 = int(subblock[0][1]) +
+         ((int(subblock[0][1]) * cospi8_sqrt2_minus1) >> 16);
+  tmp2 = (int(subblock[0][3]) * sinpi8_sqrt2) >> 16;
+  int d = tmp1 + tmp2;
+
+  for (size_t i = 0; i < 4; i++) {
+    int a = int(col[i]) + x2;
+    int b = int(col[i]) - x2;
+    subblock[i][0] = int16_t((a + d + 4) >> 3);
+    subblock[i][3] = int16_t((a - d + 4) >> 3);
+    subblock[i][1] = int16_t((b + c + 4) >> 3);
+    subblock[i][2] = int16_t((b - c + 4) >> 3);
+  }
+}
+
+void IDCTDC(std::array<std::array<int16_t, 4>, 4> &subblock) {
+  auto dc = int16_t((subblock[0][0] + 4) >> 3);
+  for (auto &row : subblock) row.fill(dc);
+}
+
 void IWHT(std::array<std::array<int16_t, 4>, 4> &subblock) {
   for (size_t i = 0; i < 4; i++) {
     int a = int(subblock.at(0).at(i)) + int(subblock.at(3).at(i));
@@ -132,4 +184,9 @@ void IWHT(std::array<std::array<int16_t, 4>, 4> &subblock) {
   }
 }
 
+void IWHTDC(std::array<std::array<int16_t, 4>, 4> &subblock) {
+  auto dc = int16_t((subblock[0][0] + 3) >> 3);
+  for (auto &row : subblock) row.fill(dc);
+}
+
 }  // namespace vp8
@@ -2,6 +2,7 @@
 #define DCT_H_
 
 #include <array>
+#include <cstdint>
 
 namespace vp8 {
 
@@ -9,10 +10,21 @@ void DCT(std::array<std::array<int16_t, 4>, 4> &subblock);
 
 void IDCT(std::array<std::array<int16_t, 4>, 4> &subblock);
 
+// The same as IDCT for a block whose non-zero coefficients all lie in its first
+// row and first column (as is any block whose end-of-block position is at most
+// 4), with the shared half of the second pass computed once.
+void IDCTRowCol(std::array<std::array<int16_t, 4>, 4> &subblock);
+
+// The same as IDCT for a block whose only non-zero coefficient is the DC.
+void IDCTDC(std::array<std::array<int16_t, 4>, 4> &subblock);
+
 void WHT(std::array<std::array<int16_t, 4>, 4> &subblock);
 
 void IWHT(std::array<std::array<int16_t, 4>, 4> &subblock);
 
+// The same as IWHT for a block whose only non-zero coefficient is the DC.
+void IWHTDC(std::array<std::array<int16_t, 4>, 4> &subblock);
+
 }  // namespace vp8
 
 #endif  // DCT_H_
@@ -1,79 +1,200 @@
 #include <array>
-#include <cassert>
-#include <fstream>
+#include <cstdio>
 #include <memory>
-#include <utility>
+#include <optional>
+#include <string>
+#include <vector>
 
-#include "bitstream_const.h"
-#include "loop.h"
-#include "decode_frame.h"
+#include "ivf.h"
+#include "md5.h"
+#include "stats.h"
+#include "trace.h"
 #include "utils.h"
+#include "vp8.h"
 #include "yuv.h"
 
-int main(int argc, const char **argv) {
-  ensure(argc == 3, "[Usage] ./decode [input] [output]");
-
-  auto fs = std::ifstream(argv[1], std::ios::binary);
-  auto read_bytes = [&fs](size_t n) {
-    uint32_t res = 0;
-    for (size_t i = 0; i < n; ++i) {
-      res |= uint32_t(fs.get()) << (i << 3);
-    }
-    return res;
-  };
+namespace {
 
-  const uint32_t dkif = uint32_t('D') | (uint32_t('K') << 8) |
-                        (uint32_t('I') << 16) | (uint32_t('F') << 24);
-  const uint32_t vp80 = uint32_t('V') | (uint32_t('P') << 8) |
-                        (uint32_t('8') << 16) | (uint32_t('0') << 24);
-  assert(read_bytes(4) == dkif);
-  assert(read_bytes(2) == 0);   // Version
-  assert(read_bytes(2) == 32);  // Header length
-  assert(read_bytes(4) == vp80);
-  read_bytes(2);
-  read_bytes(2);
-  read_bytes(4);
-  read_bytes(4);
-  auto num_frames = read_bytes(4);
-  read_bytes(4);  // Reserved bytes
+constexpr char kUsage[] =
+    "[Usage] ./decode [input] [output] [threads]\n"
+    "        ./decode [--md5] [--stats] [--trace=trace.json] [-t threads] "
+    "[--cpu=scalar|sse4.1|avx2|avx512] [-o output] [input]";
 
-  std::array<std::shared_ptr<vp8::Frame>, 4> ref_frames;
-  std::array<bool, 4> ref_frame_bias{};
+// Expand the libvpx (vpxdec) output pattern: %w and %h are replaced by the
+// frame dimensions and %1 to %9 by the (1-based) number of the compressed
+// frame, zero-padded to that many digits.
+std::string ExpandPattern(const std::string &pattern, size_t width,
+                          size_t height, size_t frame) {
+  std::string res;
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    if (pattern[i] != '%' || i + 1 == pattern.size()) {
+      res.push_back(pattern[i]);
+      continue;
+    }
+    char spec = pattern[++i];
+    if (spec == 'w') {
+      res += std::to_string(width);
+    } else if (spec == 'h') {
+      res += std::to_string(height);
+    } else if (spec >= '1' && spec <= '9') {
+      std::string num = std::to_string(frame);
+      if (num.size() < size_t(spec - '0'))
+        res.append(size_t(spec - '0') - num.size(), '0');
+      res += num;
+    } else {
+      res.push_back('%');
+      res.push_back(spec);
+    }
+  }
+  return res;
+}
 
-  vp8::ParserContext ctx{};
+void PrintStats(const vp8::DecodeStats &stats) {
+  static const std::array<const char *, vp8::kNumDecodeStages> kStageNames = {
+      "header", "modes", "tokens", "transform",
+      "predict", "filter", "border", "output"};
+  uint64_t total = 0;
+  for (uint64_t cycles : stats.cycles) total += cycles;
+  std::fprintf(stderr, "[Stats] %llu frames (%llu key frames), %s kernels\n",
+               (unsigned long long)stats.frames,
+               (unsigned long long)stats.key_frames,
+               vp8::CpuLevelName(vp8::ActiveCpuLevel()));
+  for (size_t i = 0; i < vp8::kNumDecodeStages; ++i) {
+    std::fprintf(stderr, "[Stats] %-10s %14llu cycles %6.2f%%\n",
+                 kStageNames[i], (unsigned long long)stats.cycles[i],
+                 total ? 100.0 * double(stats.cycles[i]) / double(total) : 0.0);
+  }
+  std::fprintf(stderr,
+               "[Stats] macroblocks: %llu intra, %llu B_PRED, %llu last, "
+               "%llu golden, %llu altref (%llu skipped)\n",
+               (unsigned long long)stats.intra_mbs,
+               (unsigned long long)stats.bpred_mbs,
+               (unsigned long long)stats.inter_mbs[0],
+               (unsigned long long)stats.inter_mbs[1],
+               (unsigned long long)stats.inter_mbs[2],
+               (unsigned long long)stats.skipped_mbs);
+  std::fprintf(stderr, "[Stats] bytes: %llu first partition",
+               (unsigned long long)stats.first_partition_bytes);
+  for (size_t i = 0; i < stats.partition_bytes.size(); ++i) {
+    if (stats.partition_bytes[i] == 0) continue;
+    std::fprintf(stderr, ", %llu partition %zu",
+                 (unsigned long long)stats.partition_bytes[i], i);
+  }
+  std::fprintf(stderr, "\n");
+  std::fprintf(stderr, "[Stats] frame buffers: %llu at most\n",
+               (unsigned long long)stats.frame_buffers);
+}
 
-  vp8::YUV<vp8::WRITE> yuv(argv[2]);
+// The level named name, or kNumCpuLevels if there is none.
+vp8::CpuLevel ParseCpuLevel(const std::string &name) {
+  for (size_t i = 0; i < vp8::kNumCpuLevels; ++i) {
+    if (name == vp8::CpuLevelName(vp8::CpuLevel(i))) return vp8::CpuLevel(i);
+  }
+  return vp8::kNumCpuLevels;
+}
 
-  std::vector<uint8_t> buffer;
+}  // namespace
 
-  size_t height = 0, width = 0;
-  for (size_t frame_cnt = 0; frame_cnt < num_frames; frame_cnt++) {
-    auto frame_size = read_bytes(4);
-    read_bytes(4);
-    read_bytes(4);
-    // Decoding loop: reconstruct the frame and update the golden/altref frame
-    // (if necessary).
-    buffer.resize(frame_size);
-    // TODO(willypillow): (Improvement) This part is a bit ugly.
-    fs.read(reinterpret_cast<char *>(buffer.data()), frame_size);
-    std::unique_ptr<vp8::BitstreamParser> ps =
-        std::make_unique<vp8::BitstreamParser>(
-            vp8::SpanReader(buffer.data(), buffer.data() + buffer.size()), ctx);
-    vp8::FrameHeader header;
-    vp8::FrameTag tag;
-    std::tie(tag, header) = ps->ReadFrameTagHeader();
-    if (tag.key_frame) {
-      height = tag.height;
-      width = tag.width;
+int main(int argc, const char **argv) {
+  bool md5_mode = false, stats_mode = false;
+  std::string output, trace_file;
+  std::optional<size_t> num_threads;
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--md5") {
+      md5_mode = true;
+    } else if (arg == "--stats") {
+      stats_mode = true;
+    } else if (arg.rfind("--trace=", 0) == 0) {
+      trace_file = arg.substr(8);
+    } else if (arg == "-o" || arg == "-t") {
+      ensure(i + 1 < argc, kUsage);
+      if (arg == "-o")
+        output = argv[++i];
+      else
+        num_threads = size_t(std::stoul(argv[++i]));
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      num_threads = size_t(std::stoul(arg.substr(10)));
+    } else if (arg.rfind("--cpu=", 0) == 0) {
+      vp8::CpuLevel level = ParseCpuLevel(arg.substr(6));
+      ensure(level != vp8::kNumCpuLevels, kUsage);
+      ensure(vp8::ForceCpuLevel(level),
+             "[Error] decode: The CPU does not support " + arg.substr(6) + ".");
+    } else if (arg == "--i420" || arg == "--codec=vp8") {
+      // The only output format and codec; accepted for vpxdec compatibility.
+    } else {
+      ensure(arg.empty() || arg[0] != '-', kUsage);
+      positional.push_back(arg);
     }
+  }
+  // The legacy form: [input] [output] [threads].
+  if (output.empty() && !md5_mode && positional.size() >= 2) {
+    output = positional[1];
+    positional.erase(positional.begin() + 1);
+  }
+  if (!num_threads && positional.size() == 2) {
+    num_threads = size_t(std::stoul(positional[1]));
+    positional.pop_back();
+  }
+  ensure(positional.size() == 1 && (md5_mode || !output.empty()), kUsage);
 
-    std::shared_ptr<vp8::Frame> &frame = ref_frames.at(vp8::CURRENT_FRAME);
-    frame = std::make_shared<vp8::Frame>(height, width);
+  vp8::IvfReader ivf(positional[0].c_str());
+  vp8::Decoder decoder(num_threads.value_or(1));
+  vp8::DecodeStats stats;
+  if (stats_mode) decoder.SetStats(&stats);
+  std::unique_ptr<vp8::Tracer> tracer;
+  if (!trace_file.empty()) {
+    tracer = std::make_unique<vp8::Tracer>();
+    decoder.SetTracer(tracer.get());
+  }
+
+  // A pattern with a % writes (or hashes) each frame on its own.
+  bool per_frame = output.find('%') != std::string::npos;
+  std::unique_ptr<vp8::YUV<vp8::WRITE>> yuv;
+  if (!md5_mode && !per_frame)
+    yuv = std::make_unique<vp8::YUV<vp8::WRITE>>(output.c_str());
+  vp8::MD5 md5;
 
-    vp8::InitSignBias(header, ref_frame_bias);
-    vp8::DecodeFrame(header, tag, ref_frames, ref_frame_bias, ps, frame);
-    vp8::RefreshRefFrames(header, ref_frames);
-    if (tag.show_frame) yuv.WriteFrame(frame);
+  for (size_t frame_cnt = 0; frame_cnt < ivf.size(); frame_cnt++) {
+    vp8::SpanReader<uint8_t> payload = ivf.Payload(frame_cnt);
+    std::optional<vp8::FrameView> frame =
+        decoder.Decode(payload.cursor(), payload.size());
+    if (!frame) {
+      // The library reports a corrupt frame; the tool gives up on the stream.
+      if (decoder.error() != nullptr)
+        ensure(false, "Frame " + std::to_string(frame_cnt) + ": " +
+                          decoder.error());
+      continue;
+    }
+    vp8::internal::ScopedCycles timer(
+        stats_mode ? &stats.cycles[vp8::STAGE_OUTPUT] : nullptr);
+    vp8::internal::ScopedSpan span(vp8::internal::FrameTrace{tracer.get(),
+                                                             frame_cnt},
+                                   "Output");
+    if (!per_frame) {
+      if (md5_mode)
+        vp8::UpdateFrame(md5, *frame);
+      else
+        yuv->WriteFrame(*frame);
+      continue;
+    }
+    std::string name =
+        ExpandPattern(output, frame->width, frame->height, frame_cnt + 1);
+    if (md5_mode) {
+      vp8::UpdateFrame(md5, *frame);
+      std::printf("%s  %s\n", md5.HexDigest().c_str(), name.c_str());
+      md5.Reset();
+    } else {
+      vp8::YUV<vp8::WRITE>(name.c_str()).WriteFrame(*frame);
+    }
   }
+  if (md5_mode && !per_frame)
+    std::printf("%s  %s\n", md5.HexDigest().c_str(),
+                output.empty() ? "-" : output.c_str());
+  if (stats_mode) PrintStats(stats);
+  if (tracer)
+    ensure(tracer->Write(trace_file.c_str()),
+           "[Error] decode: Fail to write the trace.");
   return 0;
 }
@@ -1,85 +1,202 @@
 #include "decode_frame.h"
 
+#include <exception>
+
+#include "stats.h"
+
 namespace vp8 {
 namespace internal {
 
-void UpdateNonzero(const ResidualValue &rv, bool has_y2, size_t r, size_t c,
+void UpdateNonzero(const ResidualData &rd, size_t r, size_t c,
                    std::vector<uint8_t> &y2_row, std::vector<uint8_t> &y2_col,
                    std::vector<std::vector<uint8_t>> &y1_nonzero,
                    std::vector<std::vector<uint8_t>> &u_nonzero,
                    std::vector<std::vector<uint8_t>> &v_nonzero) noexcept {
-  if (has_y2) {
+  // A block has non-zero coefficients iff it has an end-of-block position.
+  if (rd.has_y2) {
     // If the current coefficients contain Y2 block, then update the most recent
     // Y2 status.
-    uint8_t nonzero = 0;
-    for (size_t i = 0; i < kSubBlockSize; ++i) {
-      for (size_t j = 0; j < kSubBlockSize; ++j)
-        nonzero += rv.y2.at(i).at(j) != 0;
-    }
-    y2_row.at(r) = uint8_t(nonzero > 0);
-    y2_col.at(c) = uint8_t(nonzero > 0);
+    y2_row.at(r) = uint8_t(rd.eob.at(0) > 0);
+    y2_col.at(c) = uint8_t(rd.eob.at(0) > 0);
   }
   for (size_t p = 0; p < kNumYPerBlock; ++p) {
-    uint8_t nonzero = 0;
-    for (size_t i = 0; i < kSubBlockSize; ++i) {
-      for (size_t j = 0; j < kSubBlockSize; ++j)
-        nonzero += rv.y.at(p).at(i).at(j) != 0;
-    }
     y1_nonzero.at(r << 2 | (p >> 2)).at(c << 2 | (p & 3)) =
-        uint8_t(nonzero > 0);
+        uint8_t(rd.eob.at(p + 1) > 0);
   }
   for (size_t p = 0; p < kNumUVPerBlock; ++p) {
-    uint8_t nonzero = 0;
-    for (size_t i = 0; i < kSubBlockSize; ++i) {
-      for (size_t j = 0; j < kSubBlockSize; ++j)
-        nonzero += rv.u.at(p).at(i).at(j) != 0;
-    }
-    u_nonzero.at(r << 1 | (p >> 1)).at(c << 1 | (p & 1)) = uint8_t(nonzero > 0);
+    u_nonzero.at(r << 1 | (p >> 1)).at(c << 1 | (p & 1)) =
+        uint8_t(rd.eob.at(p + 17) > 0);
+    v_nonzero.at(r << 1 | (p >> 1)).at(c << 1 | (p & 1)) =
+        uint8_t(rd.eob.at(p + 21) > 0);
   }
-  for (size_t p = 0; p < kNumUVPerBlock; ++p) {
-    uint8_t nonzero = 0;
-    for (size_t i = 0; i < kSubBlockSize; ++i) {
-      for (size_t j = 0; j < kSubBlockSize; ++j)
-        nonzero += rv.v.at(p).at(i).at(j) != 0;
+}
+
+ResidualParam NonzeroContext(
+    size_t r, size_t c, const std::vector<uint8_t> &y2_row,
+    const std::vector<uint8_t> &y2_col,
+    const std::vector<std::vector<uint8_t>> &y1_nonzero,
+    const std::vector<std::vector<uint8_t>> &u_nonzero,
+    const std::vector<std::vector<uint8_t>> &v_nonzero) noexcept {
+  uint8_t y2_nonzero = y2_row.at(r) + y2_col.at(c);
+  uint8_t y1_above = 0, y1_left = 0;
+  uint8_t u_above = 0, u_left = 0, v_above = 0, v_left = 0;
+
+  for (size_t i = 0; i < 4; ++i) {
+    if (r > 0) y1_above |= y1_nonzero.at((r - 1) << 2 | 3).at(c << 2 | i) << i;
+    if (c > 0) y1_left |= y1_nonzero.at(r << 2 | i).at((c - 1) << 2 | 3) << i;
+  }
+  for (size_t i = 0; i < 2; ++i) {
+    if (r > 0) {
+      u_above |= u_nonzero.at((r - 1) << 1 | 1).at(c << 1 | i) << i;
+      v_above |= v_nonzero.at((r - 1) << 1 | 1).at(c << 1 | i) << i;
+    }
+    if (c > 0) {
+      u_left |= u_nonzero.at(r << 1 | i).at((c - 1) << 1 | 1) << i;
+      v_left |= v_nonzero.at(r << 1 | i).at((c - 1) << 1 | 1) << i;
     }
-    v_nonzero.at(r << 1 | (p >> 1)).at(c << 1 | (p & 1)) = uint8_t(nonzero > 0);
   }
+  return ResidualParam(y2_nonzero, y1_above, y1_left, u_above, u_left, v_above,
+                       v_left);
 }
 
-void UpdateDequantFactor(const QuantIndices &quant) {
-  static bool first_entry = true;
-  static QuantIndices config{};
-
-  if (first_entry) {
-    first_entry = false;
-    BuildQuantFactorsY2(quant, y2dqf);
-    BuildQuantFactorsY(quant, ydqf);
-    BuildQuantFactorsUV(quant, uvdqf);
-    config = quant;
+void UpdateDequantFactor(const QuantIndices &quant, DequantFactors &dequant) {
+  if (!dequant.initialized) {
+    dequant.initialized = true;
+    BuildQuantFactorsY2(quant, dequant.y2dqf);
+    BuildQuantFactorsY(quant, dequant.ydqf);
+    BuildQuantFactorsUV(quant, dequant.uvdqf);
+    dequant.config = quant;
     return;
   }
 
+  const QuantIndices &config = dequant.config;
   if (quant.y2_dc_delta_q != config.y2_dc_delta_q ||
       quant.y2_ac_delta_q != config.y2_ac_delta_q)
-    BuildQuantFactorsY2(quant, y2dqf);
+    BuildQuantFactorsY2(quant, dequant.y2dqf);
 
   if (quant.y_dc_delta_q != config.y_dc_delta_q)
-    BuildQuantFactorsY(quant, ydqf);
+    BuildQuantFactorsY(quant, dequant.ydqf);
 
   if (quant.uv_dc_delta_q != config.uv_dc_delta_q ||
       quant.uv_ac_delta_q != config.uv_ac_delta_q)
-    BuildQuantFactorsUV(quant, uvdqf);
+    BuildQuantFactorsUV(quant, dequant.uvdqf);
+
+  dequant.config = quant;
+}
 
-  config = quant;
+bool WaitFor(const std::atomic<size_t> &progress, size_t count,
+             const std::atomic<bool> &abort) {
+  while (progress.load(std::memory_order_acquire) < count) {
+    if (abort.load(std::memory_order_acquire)) return false;
+    std::this_thread::yield();
+  }
+  return true;
 }
 
+template <bool kKeyFrame>
+void ReadModes(const FrameTag &tag,
+               const std::array<bool, kNumRefFrames> &ref_frame_bias,
+               std::vector<std::vector<uint8_t>> &skip_lf,
+               const std::unique_ptr<BitstreamParser> &ps,
+               const std::shared_ptr<Frame> &frame,
+               std::vector<MacroBlockInfo> &info) {
+  std::vector<Context> ctx(frame->hblock);
+  Context ctx_left, ctx_upper_left;
+
+  info.resize(frame->vblock * frame->hblock);
+  for (size_t r = 0; r < frame->vblock; ++r) {
+    ctx_left = Context(false);
+    for (size_t c = 0; c < frame->hblock; ++c) {
+      MacroBlockInfo &mb = info.at(r * frame->hblock + c);
+      mb.pre = ps->ReadMacroBlockPreHeader();
+
+      if (!kKeyFrame && mb.pre.is_inter_mb) {
+        const std::array<Context, 3> param = {ctx.at(c), ctx_left,
+                                              ctx_upper_left};
+        Context res =
+            ReadInterModes(tag, r, c, ref_frame_bias, mb.pre.ref_frame, param,
+                           skip_lf, ps, frame, mb.chroma_mvs);
+        ctx_upper_left = ctx.at(c);
+        ctx.at(c) = ctx_left = res;
+      } else {
+        // Neighbouring inter macroblocks treat intra ones as having zero
+        // motion vectors.
+        frame->MotionAt(r, c) = MotionInfo();
+        mb.intra = kKeyFrame ? ps->ReadIntraMBHeaderKF()
+                             : ps->ReadIntraMBHeaderNonKF();
+        const std::array<Context, 2> param = {ctx.at(c), ctx_left};
+        auto res = ReadIntraModes<kKeyFrame>(param, ps, mb.intra);
+        ctx_upper_left = ctx.at(c);
+        ctx.at(c) = res.at(0);
+        ctx_left = res.at(1);
+      }
+    }
+  }
+}
+
+template void ReadModes<false>(
+    const FrameTag &tag, const std::array<bool, kNumRefFrames> &ref_frame_bias,
+    std::vector<std::vector<uint8_t>> &skip_lf,
+    const std::unique_ptr<BitstreamParser> &ps,
+    const std::shared_ptr<Frame> &frame, std::vector<MacroBlockInfo> &info);
+template void ReadModes<true>(
+    const FrameTag &tag, const std::array<bool, kNumRefFrames> &ref_frame_bias,
+    std::vector<std::vector<uint8_t>> &skip_lf,
+    const std::unique_ptr<BitstreamParser> &ps,
+    const std::shared_ptr<Frame> &frame, std::vector<MacroBlockInfo> &info);
+
+namespace {
+
+// How the quantizer index of a macroblock depends on its segment: not at all,
+// as a delta to the one of the frame, or as an absolute index.
+enum SegmentQuant {
+  SEGMENT_QUANT_NONE,
+  SEGMENT_QUANT_DELTA,
+  SEGMENT_QUANT_ABSOLUTE
+};
+
+// The PredictFunction specialized for key frames (which have no inter
+// macroblock), the SegmentQuant of the frame and, for inter frames, its
+// interpolation filters.
+template <bool kKeyFrame, SegmentQuant kSegmentQuant, bool kBilinear>
 void Predict(const FrameHeader &header, const FrameTag &tag,
              const std::array<std::shared_ptr<Frame>, 4> &refs,
-             const std::array<bool, 4> &ref_frame_bias,
-             std::vector<std::vector<uint8_t>> &lf,
+             const std::array<bool, 4> &ref_frame_bias, size_t num_threads,
+             DequantFactors &dequant, std::atomic<size_t> *recon,
+             std::atomic<bool> &abort, std::vector<std::vector<uint8_t>> &lf,
              std::vector<std::vector<uint8_t>> &skip_lf,
              const std::unique_ptr<BitstreamParser> &ps,
-             const std::shared_ptr<Frame> &frame) {
+             const std::shared_ptr<Frame> &frame, DecodeStats *stats,
+             const FrameTrace &trace) {
+  // The cycles spent by each thread in each stage, merged into stats at the
+  // end.
+  using Cycles = std::array<uint64_t, kNumDecodeStages>;
+  std::vector<Cycles> cycles(stats == nullptr ? 0
+                                              : std::max(num_threads, size_t(1)));
+  auto ThreadCycles = [&](size_t t) {
+    return stats == nullptr ? nullptr : cycles[t].data();
+  };
+
+  // Mode stage: the first partition is a single sequential stream, so the
+  // modes of the whole frame are read ahead of the other stages.
+  std::vector<MacroBlockInfo> info;
+  {
+    ScopedCycles timer(StageCounter(ThreadCycles(0), STAGE_MODES));
+    ScopedSpan span(trace, "ReadModes");
+    ReadModes<kKeyFrame>(tag, ref_frame_bias, skip_lf, ps, frame, info);
+  }
+  if (stats != nullptr) {
+    for (const MacroBlockInfo &mb : info) {
+      if (mb.pre.is_inter_mb)
+        stats->inter_mbs.at(mb.pre.ref_frame - LAST_FRAME)++;
+      else if (mb.intra.intra_y_mode == B_PRED)
+        stats->bpred_mbs++;
+      else
+        stats->intra_mbs++;
+      stats->skipped_mbs += mb.pre.mb_skip_coeff;
+    }
+  }
+
   std::vector<uint8_t> y2_row(frame->vblock, 0);
   std::vector<uint8_t> y2_col(frame->hblock, 0);
 
@@ -90,84 +207,163 @@ void Predict(const FrameHeader &header, const FrameTag &tag,
   std::vector<std::vector<uint8_t>> v_nonzero(
       frame->vblock << 1, std::vector<uint8_t>(frame->hblock << 1, 0));
 
-  std::vector<Context> ctx(frame->hblock);
-  Context ctx_left, ctx_upper_left;
+  UpdateDequantFactor(header.quant_indices, dequant);
 
-  UpdateDequantFactor(header.quant_indices);
+  // Token stage: read the residual of macroblock (r, c) and inverse transform
+  // its Y2 block. Needs the token stage of (r - 1, c) to be done for the
+  // non-zero contexts.
+  auto DecodeResidual = [&](size_t r, size_t c, MacroBlockResidual &res,
+                            uint64_t *thread_cycles) {
+    const MacroBlockPreHeader &pre = info[r * frame->hblock + c].pre;
+    int16_t qp = header.quant_indices.y_ac_qi;
+    if (kSegmentQuant == SEGMENT_QUANT_ABSOLUTE)
+      qp = header.quantizer_segment.at(pre.segment_id);
+    else if (kSegmentQuant == SEGMENT_QUANT_DELTA)
+      qp = int16_t(header.quantizer_segment.at(pre.segment_id) + qp);
 
-  for (size_t r = 0; r < frame->vblock; ++r) {
-    ctx_left = Context(false);
-    for (size_t c = 0; c < frame->hblock; ++c) {
-      MacroBlockPreHeader pre = ps->ReadMacroBlockPreHeader();
-      int16_t qp = header.quant_indices.y_ac_qi;
-      if (header.segmentation_enabled) {
-        qp = header.segment_feature_mode == SEGMENT_MODE_ABSOLUTE
-                 ? header.quantizer_segment.at(pre.segment_id)
-                 : header.quantizer_segment.at(pre.segment_id) + qp;
-      }
+    size_t dq = size_t(std::clamp(qp, int16_t(0), int16_t(127)));
 
-      size_t dq = size_t(std::clamp(qp, int16_t(0), int16_t(127)));
+    const ResidualParam param = NonzeroContext(
+        r, c, y2_row, y2_col, y1_nonzero, u_nonzero, v_nonzero);
+    ResidualData &rd = res.rd;
+    {
+      ScopedCycles timer(StageCounter(thread_cycles, STAGE_TOKENS));
+      ps->ReadResidualData(r, c, param, rd);
+    }
 
-      uint8_t y2_nonzero = y2_row.at(r) + y2_col.at(c);
-      uint8_t y1_above = 0, y1_left = 0;
-      uint8_t u_above = 0, u_left = 0, v_above = 0, v_left = 0;
+    if (!pre.mb_skip_coeff && !rd.is_zero) skip_lf.at(r).at(c) = 0;
+    lf.at(r).at(c) = rd.loop_filter_level;
+    UpdateNonzero(rd, r, c, y2_row, y2_col, y1_nonzero, u_nonzero, v_nonzero);
 
-      for (size_t i = 0; i < 4; ++i) {
-        if (r > 0)
-          y1_above |= y1_nonzero.at((r - 1) << 2 | 3).at(c << 2 | i) << i;
-        if (c > 0)
-          y1_left |= y1_nonzero.at(r << 2 | i).at((c - 1) << 2 | 3) << i;
-      }
-      for (size_t i = 0; i < 2; ++i) {
-        if (r > 0) {
-          u_above |= u_nonzero.at((r - 1) << 1 | 1).at(c << 1 | i) << i;
-          v_above |= v_nonzero.at((r - 1) << 1 | 1).at(c << 1 | i) << i;
-        }
-        if (c > 0) {
-          u_left |= u_nonzero.at(r << 1 | i).at((c - 1) << 1 | 1) << i;
-          v_left |= v_nonzero.at(r << 1 | i).at((c - 1) << 1 | 1) << i;
-        }
-      }
+    ScopedCycles timer(StageCounter(thread_cycles, STAGE_TRANSFORM));
+    InverseTransformY2(rd, dequant.y2dqf.at(dq));
+    res.ydqf = dequant.ydqf.at(dq);
+    res.uvdqf = dequant.uvdqf.at(dq);
+  };
 
-      IntraMBHeader mh;
+  const Interpolation interp(kBilinear);
 
-      if (pre.is_inter_mb) {
-        const std::array<Context, 3> param = {ctx.at(c), ctx_left,
-                                              ctx_upper_left};
-        Context res = InterPredict(tag, r, c, refs, ref_frame_bias,
-                                   pre.ref_frame, param, skip_lf, ps, frame);
-        ctx_upper_left = ctx.at(c);
-        ctx.at(c) = ctx_left = res;
-      } else {
-        mh = tag.key_frame ? ps->ReadIntraMBHeaderKF()
-                           : ps->ReadIntraMBHeaderNonKF();
-      }
+  // Reconstruction stage: predict macroblock (r, c) and add its residual, each
+  // block being dequantized and inverse transformed on the way.
+  // Needs the reconstructed pixels of (r - 1, c + 1) for intra prediction.
+  auto Reconstruct = [&](size_t r, size_t c, const MacroBlockResidual &res,
+                         uint64_t *thread_cycles) {
+    ScopedCycles timer(StageCounter(thread_cycles, STAGE_PREDICT));
+    const MacroBlockInfo &mb = info[r * frame->hblock + c];
+    if (!kKeyFrame && mb.pre.is_inter_mb) {
+      InterPredict(interp, r, c, refs, mb.pre.ref_frame, mb.chroma_mvs,
+                   frame);
+      ApplyMBResidual(res.rd, 1, res.ydqf, frame->Y.at(r, c));
+      ApplyMBResidual(res.rd, 17, res.uvdqf, frame->U.at(r, c));
+      ApplyMBResidual(res.rd, 21, res.uvdqf, frame->V.at(r, c));
+    } else {
+      IntraPredict(r, c, res, mb.intra, skip_lf, frame);
+    }
+  };
 
-      ResidualData rd = ps->ReadResidualData(ResidualParam(
-          y2_nonzero, y1_above, y1_left, u_above, u_left, v_above, v_left));
+  // Rows sharing a DCT partition have to be decoded one after another, so
+  // there is no point in having more workers than partitions.
+  size_t num_partitions = ps->num_partitions();
+  // Add up the cycles of every thread once they are done.
+  auto MergeCycles = [&] {
+    for (const Cycles &thread_cycles : cycles) {
+      for (size_t i = 0; i < kNumDecodeStages; ++i)
+        stats->cycles[i] += thread_cycles[i];
+    }
+  };
 
-      if (!pre.mb_skip_coeff && !rd.is_zero) skip_lf.at(r).at(c) = 0;
-      lf.at(r).at(c) = rd.loop_filter_level;
+  num_threads = std::min({num_threads, num_partitions, frame->vblock});
+  if (num_threads <= 1) {
+    std::vector<MacroBlockResidual> residuals(frame->hblock);
+    for (size_t r = 0; r < frame->vblock; ++r) {
+      ScopedSpan span(trace, "Predict", int64_t(r));
+      for (size_t c = 0; c < frame->hblock; ++c)
+        DecodeResidual(r, c, residuals[c], ThreadCycles(0));
+      for (size_t c = 0; c < frame->hblock; ++c)
+        Reconstruct(r, c, residuals[c], ThreadCycles(0));
+      recon[r].store(frame->hblock, std::memory_order_release);
+    }
+    MergeCycles();
+    return;
+  }
 
-      ResidualValue rv =
-          DequantizeResidualData(rd, y2dqf.at(dq), ydqf.at(dq), uvdqf.at(dq));
-      UpdateNonzero(rv, rd.has_y2, r, c, y2_row, y2_col, y1_nonzero, u_nonzero,
-                    v_nonzero);
-      InverseTransformResidual(rv, rd.has_y2);
+  // Wavefront: worker t decodes rows t, t + num_threads, ..., each first
+  // through the token stage and then through reconstruction. Both stages
+  // publish their per-row progress. The token stage of a row also waits for
+  // the previous row of the same partition to finish, since they share a bool
+  // decoder; reconstruction stays two macroblocks behind the row above.
+  std::unique_ptr<std::atomic<size_t>[]> tokens(
+      new std::atomic<size_t>[frame->vblock]);
+  for (size_t r = 0; r < frame->vblock; ++r) tokens[r].store(0);
 
-      if (pre.is_inter_mb) {
-        ApplyMBResidual(rv.y, rv.zero, frame->Y.at(r).at(c));
-        ApplyMBResidual(rv.u, rv.zero >> 16, frame->U.at(r).at(c));
-        ApplyMBResidual(rv.v, rv.zero >> 20, frame->V.at(r).at(c));
-      } else {
-        const std::array<Context, 2> param = {ctx.at(c), ctx_left};
-        auto res = IntraPredict(tag, r, c, rv, mh, param, skip_lf, ps, frame);
-        ctx_upper_left = ctx.at(c);
-        ctx.at(c) = res.at(0);
-        ctx_left = res.at(1);
+  auto DecodeRows = [&](size_t t) {
+    std::vector<MacroBlockResidual> residuals(frame->hblock);
+    for (size_t r = t; r < frame->vblock; r += num_threads) {
+      if (r >= num_partitions &&
+          !WaitFor(tokens[r - num_partitions], frame->hblock, abort))
+        return;
+      // The waits for the row above are part of the span.
+      ScopedSpan span(trace, "Predict", int64_t(r));
+      for (size_t c = 0; c < frame->hblock; ++c) {
+        if (r > 0 && !WaitFor(tokens[r - 1], c + 1, abort)) return;
+        DecodeResidual(r, c, residuals[c], ThreadCycles(t));
+        tokens[r].store(c + 1, std::memory_order_release);
       }
+      for (size_t c = 0; c < frame->hblock; ++c) {
+        if (r > 0 &&
+            !WaitFor(recon[r - 1], std::min(c + 2, frame->hblock), abort))
+          return;
+        Reconstruct(r, c, residuals[c], ThreadCycles(t));
+        recon[r].store(c + 1, std::memory_order_release);
+      }
+    }
+  };
+
+  // The first exception, rethrown once every started worker is joined (the
+  // destructor of a joinable std::thread ends the process). Only the thread
+  // setting abort writes it.
+  std::exception_ptr error;
+  auto Fail = [&] {
+    if (!abort.exchange(true, std::memory_order_acq_rel))
+      error = std::current_exception();
+  };
+  auto Worker = [&](size_t t) {
+    try {
+      DecodeRows(t);
+    } catch (...) {
+      Fail();
     }
+  };
+
+  std::vector<std::thread> workers;
+  try {
+    workers.reserve(num_threads - 1);
+    for (size_t t = 1; t < num_threads; ++t) workers.emplace_back(Worker, t);
+  } catch (...) {
+    // The rows of the missing workers would never be decoded.
+    Fail();
   }
+  if (!abort.load(std::memory_order_acquire)) Worker(0);
+  for (std::thread &worker : workers) worker.join();
+  if (error) std::rethrow_exception(error);
+  MergeCycles();
+}
+
+template <bool kKeyFrame, bool kBilinear>
+PredictFunction PickSegmentQuant(const FrameHeader &header) {
+  if (!header.segmentation_enabled)
+    return Predict<kKeyFrame, SEGMENT_QUANT_NONE, kBilinear>;
+  if (header.segment_feature_mode == SEGMENT_MODE_ABSOLUTE)
+    return Predict<kKeyFrame, SEGMENT_QUANT_ABSOLUTE, kBilinear>;
+  return Predict<kKeyFrame, SEGMENT_QUANT_DELTA, kBilinear>;
+}
+
+}  // namespace
+
+PredictFunction PickPredict(const FrameHeader &header, const FrameTag &tag) {
+  if (tag.key_frame) return PickSegmentQuant<true, false>(header);
+  return tag.version == 0 ? PickSegmentQuant<false, false>(header)
+                          : PickSegmentQuant<false, true>(header);
 }
 
 }  // namespace internal
@@ -176,14 +372,73 @@ void DecodeFrame(const FrameHeader &header, const FrameTag &tag,
                  const std::array<std::shared_ptr<Frame>, kNumRefFrames> &refs,
                  const std::array<bool, kNumRefFrames> &ref_frame_bias,
                  const std::unique_ptr<BitstreamParser> &ps,
-                 const std::shared_ptr<Frame> &frame) {
+                 internal::DequantFactors &dequant,
+                 const std::shared_ptr<Frame> &frame, size_t num_threads,
+                 DecodeStats *stats, const internal::FrameTrace &trace) {
   std::vector<std::vector<uint8_t>> lf(frame->vblock,
                                        std::vector<uint8_t>(frame->hblock));
   std::vector<std::vector<uint8_t>> skip_lf(
       frame->vblock, std::vector<uint8_t>(frame->hblock, 1));
 
-  internal::Predict(header, tag, refs, ref_frame_bias, lf, skip_lf, ps, frame);
-  FrameFilter(header, tag.key_frame, lf, skip_lf, frame);
+  // The number of reconstructed macroblocks of each row.
+  std::unique_ptr<std::atomic<size_t>[]> recon(
+      new std::atomic<size_t>[frame->vblock]);
+  for (size_t r = 0; r < frame->vblock; ++r) recon[r].store(0);
+  internal::InitIntraEdges(*frame);
+  const internal::PredictFunction predict = internal::PickPredict(header, tag);
+  // Set once a thread fails, to release the others.
+  std::atomic<bool> abort(false);
+
+  if (num_threads <= 1 || header.loop_filter_level == 0) {
+    predict(header, tag, refs, ref_frame_bias, num_threads, dequant,
+            recon.get(), abort, lf, skip_lf, ps, frame, stats, trace);
+    internal::ScopedCycles timer(
+        stats == nullptr ? nullptr : &stats->cycles[STAGE_FILTER]);
+    // Row by row, which is the same as FrameFilter, so that each row shows up
+    // in the trace.
+    for (size_t r = 0; r < frame->vblock; ++r) {
+      internal::ScopedSpan span(trace, "FilterRows", int64_t(r));
+      FilterRows(header, tag.key_frame, lf, skip_lf, r, r + 1, frame);
+    }
+  } else {
+    // Pipeline the loop filter behind reconstruction. Intra prediction of row
+    // r + 1 reads the unfiltered pixels of row r, so row r is filtered once
+    // row r + 1 is fully reconstructed. Filtering row r only touches rows r - 1
+    // and r, which no longer take part in reconstruction by then.
+    uint64_t filter_cycles = 0;
+    std::exception_ptr filter_error;
+    std::thread filter([&] {
+      try {
+        for (size_t r = 0; r < frame->vblock; ++r) {
+          if (!internal::WaitFor(recon[std::min(r + 1, frame->vblock - 1)],
+                                 frame->hblock, abort))
+            return;
+          internal::ScopedCycles timer(stats == nullptr ? nullptr
+                                                        : &filter_cycles);
+          internal::ScopedSpan span(trace, "FilterRows", int64_t(r));
+          FilterRows(header, tag.key_frame, lf, skip_lf, r, r + 1, frame);
+        }
+      } catch (...) {
+        filter_error = std::current_exception();
+      }
+    });
+    // The filter thread has to be joined whatever happens, or its destructor
+    // ends the process.
+    try {
+      predict(header, tag, refs, ref_frame_bias, num_threads, dequant,
+              recon.get(), abort, lf, skip_lf, ps, frame, stats, trace);
+    } catch (...) {
+      abort.store(true, std::memory_order_release);
+      filter.join();
+      throw;
+    }
+    filter.join();
+    if (filter_error) std::rethrow_exception(filter_error);
+    if (stats != nullptr) stats->cycles[STAGE_FILTER] += filter_cycles;
+  }
+  internal::ScopedCycles timer(
+      stats == nullptr ? nullptr : &stats->cycles[STAGE_BORDER]);
+  frame->ExtendBorders();
 }
 
 }  // namespace vp8
@@ -2,7 +2,9 @@
 #define DECODE_FRAME_H_
 
 #include <array>
+#include <atomic>
 #include <memory>
+#include <thread>
 #include <vector>
 
 #include "bitstream_parser.h"
@@ -13,37 +15,108 @@
 #include "intra_predict.h"
 #include "quantizer.h"
 #include "residual.h"
+#include "trace.h"
+#include "vp8.h"
 
 namespace vp8 {
 namespace internal {
 
-static std::array<QuantFactor, kMaxQuantIndex> y2dqf;
-static std::array<QuantFactor, kMaxQuantIndex> ydqf;
-static std::array<QuantFactor, kMaxQuantIndex> uvdqf;
+// The dequantization factors of every quantizer index, rebuilt only when the
+// deltas of the frame header change.
+struct DequantFactors {
+  std::array<QuantFactor, kMaxQuantIndex> y2dqf;
+  std::array<QuantFactor, kMaxQuantIndex> ydqf;
+  std::array<QuantFactor, kMaxQuantIndex> uvdqf;
+  QuantIndices config;
+  bool initialized;
 
-void UpdateNonzero(const ResidualValue &rv, bool has_y2, size_t r, size_t c,
+  DequantFactors() : y2dqf(), ydqf(), uvdqf(), config(), initialized(false) {}
+};
+
+void UpdateNonzero(const ResidualData &rd, size_t r, size_t c,
                    std::vector<uint8_t> &y2_row, std::vector<uint8_t> &y2_col,
                    std::vector<std::vector<uint8_t>> &y1_nonzero,
                    std::vector<std::vector<uint8_t>> &u_nonzero,
                    std::vector<std::vector<uint8_t>> &v_nonzero) noexcept;
 
-void UpdateDequantFactor(const QuantIndices &quant);
+// The non-zero contexts of macroblock (r, c) left by UpdateNonzero for the
+// macroblocks above and to its left.
+ResidualParam NonzeroContext(
+    size_t r, size_t c, const std::vector<uint8_t> &y2_row,
+    const std::vector<uint8_t> &y2_col,
+    const std::vector<std::vector<uint8_t>> &y1_nonzero,
+    const std::vector<std::vector<uint8_t>> &u_nonzero,
+    const std::vector<std::vector<uint8_t>> &v_nonzero) noexcept;
+
+void UpdateDequantFactor(const QuantIndices &quant, DequantFactors &dequant);
+
+// The modes of a macroblock, read from the first partition ahead of token
+// decoding and reconstruction (about 40 bytes per macroblock).
+struct MacroBlockInfo {
+  MacroBlockPreHeader pre;
+  // Only used when pre.is_inter_mb == false.
+  IntraMBHeader intra;
+  // Only used when pre.is_inter_mb == true; the luma motion vectors are stored
+  // in the frame.
+  std::array<MotionVector, 4> chroma_mvs;
+};
+
+// Read the modes and motion vectors of every macroblock of the frame (in
+// raster-scan order) from the first partition. kKeyFrame is tag.key_frame.
+template <bool kKeyFrame>
+void ReadModes(const FrameTag &tag,
+               const std::array<bool, kNumRefFrames> &ref_frame_bias,
+               std::vector<std::vector<uint8_t>> &skip_lf,
+               const std::unique_ptr<BitstreamParser> &ps,
+               const std::shared_ptr<Frame> &frame,
+               std::vector<MacroBlockInfo> &info);
+
+// Spin until progress reaches count. Returns false, without waiting any longer,
+// once abort is set: a thread the progress depends on has failed.
+bool WaitFor(const std::atomic<size_t> &progress, size_t count,
+             const std::atomic<bool> &abort);
+
+// Reconstruct the frame in three stages: the modes of the whole frame are read
+// first, then each macroblock row goes through token decoding followed by
+// reconstruction. With num_threads > 1 and several DCT partitions, the rows are
+// processed by a wavefront of threads. recon[r] is set to the number of
+// reconstructed macroblocks of row r as they complete. A failing worker sets
+// abort, upon which the others stop, and its exception is rethrown once they
+// have all been joined. If stats is not nullptr, the macroblocks are counted
+// and the time spent in each stage is added to it. The modes and each
+// macroblock row are recorded as spans in trace.
+using PredictFunction = void (*)(
+    const FrameHeader &header, const FrameTag &tag,
+    const std::array<std::shared_ptr<Frame>, kNumRefFrames> &refs,
+    const std::array<bool, kNumRefFrames> &ref_frame_bias, size_t num_threads,
+    DequantFactors &dequant, std::atomic<size_t> *recon,
+    std::atomic<bool> &abort, std::vector<std::vector<uint8_t>> &lf,
+    std::vector<std::vector<uint8_t>> &skip_lf,
+    const std::unique_ptr<BitstreamParser> &ps,
+    const std::shared_ptr<Frame> &frame, DecodeStats *stats,
+    const FrameTrace &trace);
 
-void Predict(const FrameHeader &header, const FrameTag &tag,
-             const std::array<std::shared_ptr<Frame>, kNumRefFrames> &refs,
-             const std::array<bool, kNumRefFrames> &ref_frame_bias,
-             std::vector<std::vector<uint8_t>> &lf,
-             std::vector<std::vector<uint8_t>> &skip_lf,
-             const std::unique_ptr<BitstreamParser> &ps,
-             const std::shared_ptr<Frame> &frame);
+// The PredictFunction of the frame, whose macroblock loop is specialized on
+// the properties that hold for the whole frame (whether it is a key frame, how
+// its segments set the quantizer and its interpolation filters) rather than
+// testing them for every macroblock.
+PredictFunction PickPredict(const FrameHeader &header, const FrameTag &tag);
 
 }  // namespace internal
 
+// Decode a frame. With num_threads > 1 the loop filter runs on a separate thread,
+// pipelined behind reconstruction; an exception thrown by either is rethrown
+// once both threads have stopped. dequant is the per-stream cache of
+// dequantization factors. The stages after the frame header are accounted for
+// in stats, if it is not nullptr, and recorded as spans in trace.
 void DecodeFrame(const FrameHeader &header, const FrameTag &tag,
                  const std::array<std::shared_ptr<Frame>, kNumRefFrames> &refs,
                  const std::array<bool, kNumRefFrames> &ref_frame_bias,
                  const std::unique_ptr<BitstreamParser> &ps,
-                 const std::shared_ptr<Frame> &frame);
+                 internal::DequantFactors &dequant,
+                 const std::shared_ptr<Frame> &frame, size_t num_threads = 1,
+                 DecodeStats *stats = nullptr,
+                 const internal::FrameTrace &trace = internal::FrameTrace());
 
 }  // namespace vp8
 
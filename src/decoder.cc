@@ -0,0 +1,129 @@
+#include "decoder.h"
+
+#include <exception>
+#include <tuple>
+
+#include "dsp.h"
+#include "loop.h"
+#include "stats.h"
+#include "trace.h"
+#include "utils.h"
+
+namespace vp8 {
+
+Decoder::Impl::Impl(size_t num_threads)
+    : num_threads_(num_threads),
+      height_(0),
+      width_(0),
+      ctx_(),
+      pool_(),
+      ref_frames_(),
+      ref_frame_bias_(),
+      dequant_(),
+      shown_(),
+      stats_(nullptr),
+      tracer_(nullptr),
+      num_frames_(0),
+      error_() {
+  internal::InitDsp();
+}
+
+std::shared_ptr<Frame> Decoder::Impl::Decode(const uint8_t *data, size_t size) {
+  error_.clear();
+  // DecodeError for a corrupt or unsupported frame, std::out_of_range for a
+  // truncated one, std::bad_alloc for dimensions too large to allocate (or
+  // memory running out) and std::system_error for a thread failing to start.
+  // DecodeFrame rethrows those of its threads once they are all joined.
+  try {
+    return DecodeOrThrow(data, size);
+  } catch (const std::exception &e) {
+    error_ = e.what();
+  }
+  height_ = width_ = 0;
+  shown_.reset();
+  for (std::shared_ptr<Frame> &frame : ref_frames_) frame.reset();
+  return nullptr;
+}
+
+std::shared_ptr<Frame> Decoder::Impl::DecodeOrThrow(const uint8_t *data,
+                                                    size_t size) {
+  // Release the previously shown frame first so that its buffer can be reused.
+  shown_.reset();
+  internal::FrameTrace trace{tracer_, num_frames_++};
+  uint64_t header_start = stats_ == nullptr ? 0 : internal::ReadCycles();
+  uint64_t span_start = tracer_ == nullptr ? 0 : Tracer::Now();
+  std::unique_ptr<BitstreamParser> ps = std::make_unique<BitstreamParser>(
+      SpanReader(data, data + size), ctx_);
+  FrameHeader header;
+  FrameTag tag;
+  std::tie(tag, header) = ps->ReadFrameTagHeader();
+  if (tracer_ != nullptr)
+    tracer_->Record("ReadFrameTagHeader", span_start, Tracer::Now(),
+                    trace.frame);
+  if (stats_ != nullptr) {
+    stats_->cycles[STAGE_HEADER] += internal::ReadCycles() - header_start;
+    stats_->frames++;
+    stats_->key_frames += tag.key_frame;
+    stats_->first_partition_bytes +=
+        (tag.key_frame ? 10 : 3) + ps->first_part_size();
+    for (size_t i = 0; i < ps->num_partitions(); ++i)
+      stats_->partition_bytes.at(i) += ps->partition_size(i);
+  }
+  if (tag.key_frame) {
+    height_ = tag.height;
+    width_ = tag.width;
+  }
+  check(height_ > 0 && width_ > 0,
+        "[Error] Decode: The stream does not start with a key frame.");
+
+  // Drop the previous frame first so that its buffer can be reused if it is
+  // not kept as a reference frame.
+  std::shared_ptr<Frame> &frame = ref_frames_.at(CURRENT_FRAME);
+  frame.reset();
+  frame = pool_.Acquire(height_, width_);
+  if (stats_ != nullptr) {
+    stats_->frame_buffers =
+        std::max(stats_->frame_buffers, uint64_t(pool_.HighWaterMark()));
+  }
+
+  InitSignBias(header, ref_frame_bias_);
+  DecodeFrame(header, tag, ref_frames_, ref_frame_bias_, ps, dequant_, frame,
+              num_threads_, stats_, trace);
+  RefreshRefFrames(header, ref_frames_);
+  if (tag.show_frame) shown_ = frame;
+  return shown_;
+}
+
+Decoder::Decoder(size_t num_threads)
+    : impl_(std::make_unique<Impl>(num_threads)) {}
+
+Decoder::~Decoder() = default;
+
+Decoder::Decoder(Decoder &&) noexcept = default;
+
+Decoder &Decoder::operator=(Decoder &&) noexcept = default;
+
+std::optional<FrameView> Decoder::Decode(const uint8_t *data, size_t size) {
+  std::shared_ptr<Frame> shown = impl_->Decode(data, size);
+  if (!shown) return std::nullopt;
+
+  const Frame &frame = *shown;
+  FrameView view;
+  view.width = frame.hsize;
+  view.height = frame.vsize;
+  view.planes = {frame.Y.Row(0), frame.U.Row(0), frame.V.Row(0)};
+  view.strides = {frame.Y.stride(), frame.U.stride(), frame.V.stride()};
+  return view;
+}
+
+void Decoder::SetStats(DecodeStats *stats) { impl_->SetStats(stats); }
+
+void Decoder::SetTracer(Tracer *tracer) { impl_->SetTracer(tracer); }
+
+size_t Decoder::height() const { return impl_->height(); }
+
+size_t Decoder::width() const { return impl_->width(); }
+
+const char *Decoder::error() const { return impl_->error(); }
+
+}  // namespace vp8
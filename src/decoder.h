@@ -0,0 +1,68 @@
+#ifndef DECODER_H_
+#define DECODER_H_
+
+#include <array>
+#include <memory>
+#include <string>
+
+#include "bitstream_const.h"
+#include "bitstream_parser.h"
+#include "decode_frame.h"
+#include "frame.h"
+#include "frame_pool.h"
+#include "vp8.h"
+
+namespace vp8 {
+
+// The state of a Decoder. Everything carried from one frame to the next (the
+// parser context, the reference frames and the dequantization factors) is
+// owned by the instance.
+class Decoder::Impl {
+ public:
+  explicit Impl(size_t num_threads);
+
+  // The parser context refers to its own members.
+  Impl(const Impl &) = delete;
+  Impl &operator=(const Impl &) = delete;
+
+  // Decode the next compressed frame of the stream. Returns the decoded frame
+  // if it is meant to be shown and nullptr otherwise. The shown frame is not
+  // reused before the next call, nor while the caller holds on to it. If the
+  // frame cannot be decoded, returns nullptr with error() set and drops the
+  // reference frames, so that only a key frame can be decoded next.
+  std::shared_ptr<Frame> Decode(const uint8_t *data, size_t size);
+
+  void SetStats(DecodeStats *stats) { stats_ = stats; }
+  void SetTracer(Tracer *tracer) { tracer_ = tracer; }
+
+  size_t height() const { return height_; }
+  size_t width() const { return width_; }
+
+  const char *error() const {
+    return error_.empty() ? nullptr : error_.c_str();
+  }
+
+ private:
+  // Decode throws DecodeError (or std::out_of_range for a truncated frame).
+  std::shared_ptr<Frame> DecodeOrThrow(const uint8_t *data, size_t size);
+
+  size_t num_threads_;
+  size_t height_, width_;
+  ParserContext ctx_;
+  FramePool pool_;
+  std::array<std::shared_ptr<Frame>, kNumRefFrames> ref_frames_;
+  std::array<bool, kNumRefFrames> ref_frame_bias_;
+  internal::DequantFactors dequant_;
+  // The last shown frame, kept alive for the view handed out by Decode.
+  std::shared_ptr<Frame> shown_;
+  DecodeStats *stats_;
+  Tracer *tracer_;
+  // The number of frames decoded so far, to tag the spans with.
+  uint64_t num_frames_;
+  // Why the last call to Decode failed, empty if it did not.
+  std::string error_;
+};
+
+}  // namespace vp8
+
+#endif  // DECODER_H_
@@ -0,0 +1,108 @@
+#include "dsp.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "utils.h"
+
+namespace vp8 {
+namespace internal {
+
+std::atomic<const DspKernels *> active_kernels(nullptr);
+
+namespace {
+
+constexpr std::array<const char *, kNumCpuLevels> kCpuLevelNames = {
+    "scalar", "sse4.1", "avx2", "avx512"};
+
+std::once_flag init_flag;
+
+const DspKernels *KernelsOf(CpuLevel level) {
+  switch (level) {
+    case CPU_SSE41:
+      return Sse41Kernels();
+    case CPU_AVX2:
+      return Avx2Kernels();
+    case CPU_AVX512:
+      return Avx512Kernels();
+    default:
+      return ScalarKernels();
+  }
+}
+
+// Whether the CPU (and the operating system, for the wider registers)
+// supports level, as reported by cpuid.
+bool CpuSupports(CpuLevel level) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  switch (level) {
+    case CPU_SSE41:
+      return __builtin_cpu_supports("sse4.1");
+    case CPU_AVX2:
+      return __builtin_cpu_supports("avx2");
+    case CPU_AVX512:
+      return __builtin_cpu_supports("avx512f") &&
+             __builtin_cpu_supports("avx512bw") &&
+             __builtin_cpu_supports("avx512vl");
+    default:
+      return true;
+  }
+#else
+  return level == CPU_SCALAR;
+#endif
+}
+
+// The level named by VP8_CPU_LEVEL, or kNumCpuLevels if it is not set.
+CpuLevel LevelFromEnvironment() {
+  const char *name = std::getenv("VP8_CPU_LEVEL");
+  if (name == nullptr || *name == '\0') return kNumCpuLevels;
+  for (size_t i = 0; i < kNumCpuLevels; ++i) {
+    if (std::strcmp(name, kCpuLevelNames.at(i)) == 0) return CpuLevel(i);
+  }
+  throw std::invalid_argument("[Error] InitDsp: Unknown VP8_CPU_LEVEL " +
+                              std::string(name) +
+                              " (expected scalar, sse4.1, avx2 or avx512).");
+}
+
+}  // namespace
+
+const DspKernels *InitDsp() {
+  std::call_once(init_flag, [] {
+    CpuLevel level = std::min(DetectCpuLevel(), LevelFromEnvironment());
+    const DspKernels *expected = nullptr;
+    // Unless ForceCpuLevel got there first.
+    active_kernels.compare_exchange_strong(expected, KernelsOf(level),
+                                           std::memory_order_acq_rel);
+  });
+  return active_kernels.load(std::memory_order_acquire);
+}
+
+}  // namespace internal
+
+using namespace internal;
+
+CpuLevel DetectCpuLevel() {
+  for (size_t i = kNumCpuLevels; i-- > 0;) {
+    auto level = CpuLevel(i);
+    if (KernelsOf(level) != nullptr && CpuSupports(level)) return level;
+  }
+  return CPU_SCALAR;
+}
+
+CpuLevel ActiveCpuLevel() { return Dsp().level; }
+
+bool ForceCpuLevel(CpuLevel level) {
+  if (level >= kNumCpuLevels || level > DetectCpuLevel()) return false;
+  active_kernels.store(KernelsOf(level), std::memory_order_release);
+  return true;
+}
+
+const char *CpuLevelName(CpuLevel level) {
+  return level < kNumCpuLevels ? kCpuLevelNames.at(level) : "unknown";
+}
+
+}  // namespace vp8
@@ -0,0 +1,100 @@
+#ifndef DSP_H_
+#define DSP_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "bitstream_const.h"
+#include "vp8.h"
+
+namespace vp8 {
+namespace internal {
+
+// The whole-block intra predictors, which index DspKernels::pred16 and pred8.
+// The first four are the MacroBlockModes of the same value; DC prediction of a
+// block missing the row above it, the column to its left or both has a kernel
+// of its own.
+enum IntraKernel {
+  INTRA_DC,
+  INTRA_V,
+  INTRA_H,
+  INTRA_TM,
+  INTRA_DC_NO_TOP,
+  INTRA_DC_NO_LEFT,
+  INTRA_DC_NO_EDGE,
+  kNumIntraKernels
+};
+
+// The hot kernels, built once per CpuLevel (see dsp_kernels.h). A block of
+// coefficients is 16 int16_t in raster-scan order; pixels are addressed by a
+// pointer to the top-left one and the stride of the plane.
+struct DspKernels {
+  CpuLevel level;
+
+  // Dequantize a 4x4 block of coefficients (the first one by dc_factor, the
+  // others by ac_factor), inverse transform it and add it to the pixels,
+  // clamped to [0, 255], without going through memory in between. eob is the
+  // end-of-block position of the block, above 1.
+  void (*dequant_idct_add)(const int16_t *coeffs, int16_t dc_factor,
+                           int16_t ac_factor, uint8_t eob, uint8_t *dst,
+                           size_t stride);
+
+  // Add the residual of a block whose only non-zero coefficient is dc.
+  void (*add_dc)(int16_t dc, uint8_t *dst, size_t stride);
+
+  // Sixtap interpolation of the width x height block at src (both being 4, 8
+  // or 16): filter the height + 5 rows starting 2 rows above it horizontally
+  // with hfilter, then the result vertically with vfilter (both of 6 taps).
+  // Up to 3 pixels past the right end of the window of each row may be read.
+  void (*sixtap)(const uint8_t *src, size_t src_stride, size_t width,
+                 size_t height, const int16_t *hfilter, const int16_t *vfilter,
+                 uint8_t *dst, size_t dst_stride);
+
+  // The same as sixtap with the bilinear filters, of which only the taps 2 and
+  // 3 are non-zero: the first pass filters the height + 1 rows starting at src.
+  void (*bilinear)(const uint8_t *src, size_t src_stride, size_t width,
+                   size_t height, const int16_t *hfilter,
+                   const int16_t *vfilter, uint8_t *dst, size_t dst_stride);
+
+  // Intra prediction of the 16x16 (luma) and 8x8 (chroma) block at dst, in
+  // place, from the pixels around it: the row above it (dst - stride, the
+  // above-left pixel included) and the column to its left (dst - 1).
+  void (*pred16[kNumIntraKernels])(uint8_t *dst, size_t stride);
+  void (*pred8[kNumIntraKernels])(uint8_t *dst, size_t stride);
+
+  // Intra prediction of the 4x4 subblock at dst, indexed by SubBlockMode, from
+  // the 8 pixels at above (the above-right ones included, above[-1] being the
+  // above-left one) and the column to its left (dst - 1).
+  void (*pred4[kNumIntraBModes])(const uint8_t *above, uint8_t *dst,
+                                 size_t stride);
+
+  // Whether the loop filter runs whole edges at once (see
+  // MacroBlockEdgesNormal) rather than pixel by pixel.
+  bool simd_loop_filter;
+};
+
+// The kernels of each level, or nullptr if the level is not built (the SIMD
+// levels are only built for x86).
+const DspKernels *ScalarKernels();
+const DspKernels *Sse41Kernels();
+const DspKernels *Avx2Kernels();
+const DspKernels *Avx512Kernels();
+
+extern std::atomic<const DspKernels *> active_kernels;
+
+// Pick the kernels (once) unless they have been picked already, and return
+// them.
+const DspKernels *InitDsp();
+
+// The kernels in use.
+inline const DspKernels &Dsp() {
+  const DspKernels *kernels = active_kernels.load(std::memory_order_acquire);
+  if (__builtin_expect(kernels == nullptr, false)) kernels = InitDsp();
+  return *kernels;
+}
+
+}  // namespace internal
+}  // namespace vp8
+
+#endif  // DSP_H_
@@ -0,0 +1,19 @@
+// The kernels of CPU_AVX2, built with -mavx2 (see CMakeLists.txt and
+// the Makefile).
+
+#include "dsp.h"
+
+#if defined(__AVX2__)
+#define VP8_DSP_KERNELS Avx2Kernels
+#define VP8_DSP_LEVEL 2
+#include "dsp_kernels.h"
+#else
+namespace vp8 {
+namespace internal {
+
+// Not built for this architecture.
+const DspKernels *Avx2Kernels() { return nullptr; }
+
+}  // namespace internal
+}  // namespace vp8
+#endif
@@ -0,0 +1,23 @@
+// The kernels of CPU_AVX512: those of CPU_AVX2. The kernels work on one 16
+// pixel row or 4x4 block per register, which already fits in 128 or 256 bits;
+// a 16x16 sixtap taking two rows per 512-bit register measured no faster than
+// the AVX2 one, so there is no AVX-512 code (and no -mavx512* flag) to build.
+
+#include "dsp.h"
+
+namespace vp8 {
+namespace internal {
+
+const DspKernels *Avx512Kernels() {
+  const DspKernels *avx2 = Avx2Kernels();
+  if (avx2 == nullptr) return nullptr;
+  static const DspKernels kernels = [avx2] {
+    DspKernels copy = *avx2;
+    copy.level = CPU_AVX512;
+    return copy;
+  }();
+  return &kernels;
+}
+
+}  // namespace internal
+}  // namespace vp8
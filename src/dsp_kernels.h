@@ -0,0 +1,721 @@
+// The kernels of DspKernels, included by one translation unit per CpuLevel
+// (dsp_scalar.cc, dsp_sse41.cc, ...), each compiled for its instruction set.
+// It defines VP8_DSP_LEVEL as the CpuLevel and VP8_DSP_KERNELS as the name of
+// the function returning its table. The kernels are written with intrinsics
+// up to the level, the plain loops being left to the compiler to vectorize.
+//
+// Everything here has internal linkage, and no inline function of another
+// header is used: the linker would otherwise be free to pick, say, the AVX2
+// copy of a function for the scalar kernels.
+
+#if !defined(VP8_DSP_KERNELS) || !defined(VP8_DSP_LEVEL)
+#error "VP8_DSP_KERNELS and VP8_DSP_LEVEL must be defined."
+#endif
+
+#include <cstring>
+
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+#include <smmintrin.h>
+#endif
+#if VP8_DSP_LEVEL >= 2  // CPU_AVX2
+#include <immintrin.h>
+#endif
+
+#include "dsp.h"
+
+namespace vp8 {
+namespace internal {
+namespace {
+
+constexpr auto kLevel = CpuLevel(VP8_DSP_LEVEL);
+
+inline int16_t Clamp(int16_t x) { return x < 0 ? 0 : x > 255 ? 255 : x; }
+
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+// The low 16 bits of each lane, sign-extended.
+inline __m128i Truncate16(__m128i x) {
+  return _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+}
+
+// (x * k) >> 16 in each lane.
+inline __m128i MulShift16(__m128i x, int32_t k) {
+  return _mm_srai_epi32(_mm_mullo_epi32(x, _mm_set1_epi32(k)), 16);
+}
+
+inline void Transpose(__m128i &r0, __m128i &r1, __m128i &r2, __m128i &r3) {
+  __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpacklo_epi32(r2, r3);
+  __m128i t2 = _mm_unpackhi_epi32(r0, r1), t3 = _mm_unpackhi_epi32(r2, r3);
+  r0 = _mm_unpacklo_epi64(t0, t1);
+  r1 = _mm_unpackhi_epi64(t0, t1);
+  r2 = _mm_unpacklo_epi64(t2, t3);
+  r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+inline __m128i Load4(const uint8_t *src) {
+  int32_t x;
+  std::memcpy(&x, src, 4);
+  return _mm_cvtsi32_si128(x);
+}
+
+inline void Store4(uint8_t *dst, __m128i x) {
+  int32_t v = _mm_cvtsi128_si32(x);
+  std::memcpy(dst, &v, 4);
+}
+
+inline __m128i Load8(const void *src) {
+  return _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src));
+}
+
+inline void Store8(void *dst, __m128i x) {
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), x);
+}
+
+inline __m128i Load16(const void *src) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+}
+
+inline void Store16(void *dst, __m128i x) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), x);
+}
+
+// The filter taps k and k + 1, interleaved for _mm_madd_epi16.
+inline __m128i TapPair(const int16_t *filter, size_t k) {
+  return _mm_set1_epi32(int32_t(uint16_t(filter[k])) |
+                        int32_t(uint32_t(uint16_t(filter[k + 1])) << 16));
+}
+#endif
+
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+// Add the 8 int16_t of residual to the 4 pixels of row0 and the 4 of row1. The
+// sums wrap around in 16 bits exactly as the int16_t conversion of the scalar
+// version, and packing clamps them.
+inline void AddRows(__m128i residual, uint8_t *row0, uint8_t *row1) {
+  __m128i pixels =
+      _mm_cvtepu8_epi16(_mm_unpacklo_epi32(Load4(row0), Load4(row1)));
+  __m128i sum = _mm_add_epi16(pixels, residual);
+  __m128i packed = _mm_packus_epi16(sum, sum);
+  Store4(row0, packed);
+  Store4(row1, _mm_srli_si128(packed, 4));
+}
+#endif
+
+// The same arithmetic as Dequantize in quantizer.cc, IDCT in dct.cc (32-bit
+// intermediates included) and adding the residual to the pixels.
+void DequantIDCTAdd(const int16_t *coeffs, int16_t dc_factor,
+                    int16_t ac_factor, uint8_t eob, uint8_t *dst,
+                    size_t stride) {
+  constexpr int kCos = 20091, kSin = 35468;
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+  if (eob <= 4) {
+    // Only the first row and column can be non-zero (see IDCTRowCol in
+    // dct.cc): the first pass transforms the first column and copies the
+    // others down, then the odd half of the second pass is the same for every
+    // row, so that row i of the residual is (col[i] + k) >> 3.
+    auto dequant = [&](size_t i) {
+      return int(int16_t(coeffs[i] * ac_factor));
+    };
+    int x0 = int16_t(coeffs[0] * dc_factor), x1 = dequant(1), x2 = dequant(2);
+    int x3 = dequant(3), y1 = dequant(4), y2 = dequant(8), y3 = dequant(12);
+    int a = x0 + y2, b = x0 - y2;
+    int c = ((y1 * kSin) >> 16) - (y3 + ((y3 * kCos) >> 16));
+    int d = y1 + ((y1 * kCos) >> 16) + ((y3 * kSin) >> 16);
+    const int col[4] = {int16_t(a + d), int16_t(b + c), int16_t(b - c),
+                        int16_t(a - d)};
+    c = ((x1 * kSin) >> 16) - (x3 + ((x3 * kCos) >> 16));
+    d = x1 + ((x1 * kCos) >> 16) + ((x3 * kSin) >> 16);
+    __m128i k = _mm_setr_epi32(x2 + d + 4, c - x2 + 4, -c - x2 + 4, x2 - d + 4);
+    __m128i rows[4];
+    for (size_t i = 0; i < 4; ++i) {
+      rows[i] = Truncate16(
+          _mm_srai_epi32(_mm_add_epi32(_mm_set1_epi32(col[i]), k), 3));
+    }
+    AddRows(_mm_packs_epi32(rows[0], rows[1]), dst, dst + stride);
+    AddRows(_mm_packs_epi32(rows[2], rows[3]), dst + 2 * stride,
+            dst + 3 * stride);
+    return;
+  }
+  __m128i ac = _mm_set1_epi16(ac_factor);
+  __m128i lo =
+      _mm_mullo_epi16(Load16(coeffs), _mm_insert_epi16(ac, dc_factor, 0));
+  __m128i hi = _mm_mullo_epi16(Load16(coeffs + 8), ac);
+  // One row per register, so that the first pass works on the four columns
+  // at once; the second one works on the transposed block.
+  __m128i r0 = _mm_cvtepi16_epi32(lo);
+  __m128i r1 = _mm_cvtepi16_epi32(_mm_srli_si128(lo, 8));
+  __m128i r2 = _mm_cvtepi16_epi32(hi);
+  __m128i r3 = _mm_cvtepi16_epi32(_mm_srli_si128(hi, 8));
+  for (int pass = 0; pass < 2; ++pass) {
+    __m128i a = _mm_add_epi32(r0, r2), b = _mm_sub_epi32(r0, r2);
+    __m128i c = _mm_sub_epi32(MulShift16(r1, kSin),
+                              _mm_add_epi32(r3, MulShift16(r3, kCos)));
+    __m128i d = _mm_add_epi32(_mm_add_epi32(r1, MulShift16(r1, kCos)),
+                              MulShift16(r3, kSin));
+    __m128i o0 = _mm_add_epi32(a, d), o1 = _mm_add_epi32(b, c);
+    __m128i o2 = _mm_sub_epi32(b, c), o3 = _mm_sub_epi32(a, d);
+    if (pass == 1) {
+      __m128i round = _mm_set1_epi32(4);
+      o0 = _mm_srai_epi32(_mm_add_epi32(o0, round), 3);
+      o1 = _mm_srai_epi32(_mm_add_epi32(o1, round), 3);
+      o2 = _mm_srai_epi32(_mm_add_epi32(o2, round), 3);
+      o3 = _mm_srai_epi32(_mm_add_epi32(o3, round), 3);
+    }
+    r0 = Truncate16(o0);
+    r1 = Truncate16(o1);
+    r2 = Truncate16(o2);
+    r3 = Truncate16(o3);
+    Transpose(r0, r1, r2, r3);
+  }
+  // Back in rows; the lanes fit in 16 bits so packing does not saturate.
+  AddRows(_mm_packs_epi32(r0, r1), dst, dst + stride);
+  AddRows(_mm_packs_epi32(r2, r3), dst + 2 * stride, dst + 3 * stride);
+#else
+  int16_t block[16];
+  block[0] = int16_t(coeffs[0] * dc_factor);
+  for (size_t i = 1; i < 16; ++i) block[i] = int16_t(coeffs[i] * ac_factor);
+  // Within the first 4 coefficients in zigzag order, the columns but the
+  // first one only have their top coefficient (see IDCTRowCol in dct.cc),
+  // which the first pass copies down.
+  size_t columns = eob <= 4 ? 1 : 4;
+  for (size_t i = 0; i < columns; i++) {
+    int a = int(block[i]) + int(block[8 + i]);
+    int b = int(block[i]) - int(block[8 + i]);
+    int c = ((int(block[4 + i]) * kSin) >> 16) -
+            (int(block[12 + i]) + ((int(block[12 + i]) * kCos) >> 16));
+    int d = int(block[4 + i]) + ((int(block[4 + i]) * kCos) >> 16) +
+            ((int(block[12 + i]) * kSin) >> 16);
+    block[i] = int16_t(a + d);
+    block[12 + i] = int16_t(a - d);
+    block[4 + i] = int16_t(b + c);
+    block[8 + i] = int16_t(b - c);
+  }
+  for (size_t i = columns; i < 4; i++)
+    block[4 + i] = block[8 + i] = block[12 + i] = block[i];
+  for (size_t i = 0; i < 4; i++) {
+    const int16_t *row = block + 4 * i;
+    int a = int(row[0]) + int(row[2]);
+    int b = int(row[0]) - int(row[2]);
+    int c = ((int(row[1]) * kSin) >> 16) -
+            (int(row[3]) + ((int(row[3]) * kCos) >> 16));
+    int d = int(row[1]) + ((int(row[1]) * kCos) >> 16) +
+            ((int(row[3]) * kSin) >> 16);
+    const int16_t residual[4] = {
+        int16_t((a + d + 4) >> 3), int16_t((b + c + 4) >> 3),
+        int16_t((b - c + 4) >> 3), int16_t((a - d + 4) >> 3)};
+    uint8_t *pixels = dst + i * stride;
+    for (size_t j = 0; j < 4; ++j)
+      pixels[j] = uint8_t(Clamp(int16_t(pixels[j] + residual[j])));
+  }
+#endif
+}
+
+void AddDC(int16_t dc, uint8_t *dst, size_t stride) {
+  auto coeff = int16_t((dc + 4) >> 3);
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+  __m128i add = _mm_set1_epi16(coeff);
+  AddRows(add, dst, dst + stride);
+  AddRows(add, dst + 2 * stride, dst + 3 * stride);
+#else
+  for (size_t i = 0; i < 4; ++i) {
+    uint8_t *row = dst + i * stride;
+    for (size_t j = 0; j < 4; ++j)
+      row[j] = uint8_t(Clamp(int16_t(row[j] + coeff)));
+  }
+#endif
+}
+
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+// The taps k and l of a filter as int8_t pairs, for _mm_maddubs_epi16. The
+// taps fit in 8 bits but for the 128 of the whole-pixel filters, whose passes
+// are skipped.
+inline __m128i TapPair8(const int16_t *filter, size_t k, size_t l) {
+  return _mm_set1_epi16(int16_t(uint16_t(uint8_t(filter[k])) |
+                                uint16_t(uint8_t(filter[l])) << 8));
+}
+
+// Sixtap filters pair their taps as (k0, k5), (k1, k3) and (k2, k4): none of
+// the pairs can overflow 16 bits, and (k0, k5) is never negative, so adding it
+// last only saturates sums which clamp to 255 anyway.
+struct Taps8 {
+  explicit Taps8(const int16_t *filter)
+      : t05(TapPair8(filter, 0, 5)),
+        t13(TapPair8(filter, 1, 3)),
+        t24(TapPair8(filter, 2, 4)) {}
+
+  __m128i t05, t13, t24;
+};
+
+// The rounded sums of 8 pixels from the products of the three pairs of taps.
+inline __m128i SumTaps(__m128i p05, __m128i p13, __m128i p24) {
+  __m128i sum = _mm_adds_epi16(_mm_adds_epi16(p13, p24), p05);
+  return _mm_srai_epi16(_mm_adds_epi16(sum, _mm_set1_epi16(64)), 7);
+}
+
+// The horizontal sixtap of the 8 pixels at row + 2, as int16_t. Reads
+// row[0, 16).
+inline __m128i HorizontalSixtap8(const uint8_t *row, const Taps8 &taps) {
+  __m128i x = Load16(row);
+  __m128i x05 = _mm_shuffle_epi8(
+      x, _mm_setr_epi8(0, 5, 1, 6, 2, 7, 3, 8, 4, 9, 5, 10, 6, 11, 7, 12));
+  __m128i x13 = _mm_shuffle_epi8(
+      x, _mm_setr_epi8(1, 3, 2, 4, 3, 5, 4, 6, 5, 7, 6, 8, 7, 9, 8, 10));
+  __m128i x24 = _mm_shuffle_epi8(
+      x, _mm_setr_epi8(2, 4, 3, 5, 4, 6, 5, 7, 6, 8, 7, 9, 8, 10, 9, 11));
+  return SumTaps(_mm_maddubs_epi16(x05, taps.t05),
+                 _mm_maddubs_epi16(x13, taps.t13),
+                 _mm_maddubs_epi16(x24, taps.t24));
+}
+
+// The vertical sixtap of the low 8 pixels (high if hi) of rows[0, 6), as
+// int16_t.
+inline __m128i VerticalSixtap8(const __m128i *rows, bool hi,
+                               const Taps8 &taps) {
+  auto interleave = [hi](__m128i a, __m128i b) {
+    return hi ? _mm_unpackhi_epi8(a, b) : _mm_unpacklo_epi8(a, b);
+  };
+  return SumTaps(_mm_maddubs_epi16(interleave(rows[0], rows[5]), taps.t05),
+                 _mm_maddubs_epi16(interleave(rows[1], rows[3]), taps.t13),
+                 _mm_maddubs_epi16(interleave(rows[2], rows[4]), taps.t24));
+}
+#endif
+
+#if VP8_DSP_LEVEL >= 2  // CPU_AVX2
+inline __m256i Broadcast(__m128i x) { return _mm256_broadcastsi128_si256(x); }
+
+inline __m128i Pack(__m256i x) {
+  return _mm_packus_epi16(_mm256_castsi256_si128(x),
+                          _mm256_extracti128_si256(x, 1));
+}
+
+inline __m256i SumTaps(__m256i p05, __m256i p13, __m256i p24) {
+  __m256i sum = _mm256_adds_epi16(_mm256_adds_epi16(p13, p24), p05);
+  return _mm256_srai_epi16(_mm256_adds_epi16(sum, _mm256_set1_epi16(64)), 7);
+}
+
+// HorizontalSixtap8 of row and row + 8 at once, packed. Reads row[0, 24).
+inline __m128i HorizontalSixtap16(const uint8_t *row, const Taps8 &taps) {
+  __m256i x = _mm256_inserti128_si256(_mm256_castsi128_si256(Load16(row)),
+                                      Load16(row + 8), 1);
+  __m256i x05 = _mm256_shuffle_epi8(
+      x, Broadcast(_mm_setr_epi8(0, 5, 1, 6, 2, 7, 3, 8, 4, 9, 5, 10, 6, 11,
+                                 7, 12)));
+  __m256i x13 = _mm256_shuffle_epi8(
+      x, Broadcast(_mm_setr_epi8(1, 3, 2, 4, 3, 5, 4, 6, 5, 7, 6, 8, 7, 9, 8,
+                                 10)));
+  __m256i x24 = _mm256_shuffle_epi8(
+      x, Broadcast(_mm_setr_epi8(2, 4, 3, 5, 4, 6, 5, 7, 6, 8, 7, 9, 8, 10, 9,
+                                 11)));
+  return Pack(SumTaps(_mm256_maddubs_epi16(x05, Broadcast(taps.t05)),
+                      _mm256_maddubs_epi16(x13, Broadcast(taps.t13)),
+                      _mm256_maddubs_epi16(x24, Broadcast(taps.t24))));
+}
+
+// VerticalSixtap8 of the low and high 8 pixels at once, packed.
+inline __m128i VerticalSixtap16(const __m128i *rows, const Taps8 &taps) {
+  auto interleave = [](__m128i a, __m128i b) {
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_unpacklo_epi8(a, b)),
+        _mm_unpackhi_epi8(a, b), 1);
+  };
+  return Pack(
+      SumTaps(_mm256_maddubs_epi16(interleave(rows[0], rows[5]),
+                                   Broadcast(taps.t05)),
+              _mm256_maddubs_epi16(interleave(rows[1], rows[3]),
+                                   Broadcast(taps.t13)),
+              _mm256_maddubs_epi16(interleave(rows[2], rows[4]),
+                                   Broadcast(taps.t24))));
+}
+#endif
+
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+// Sixtap of a block 8 or 16 pixels wide, one row of pixels per register.
+void SixtapWide(const uint8_t *src, size_t src_stride, size_t width,
+                size_t height, const int16_t *hfilter, const int16_t *vfilter,
+                uint8_t *dst, size_t dst_stride) {
+  // A filter with 128 as its third tap is the identity, whose pass is
+  // skipped; without the vertical pass only rows [2, height + 2) are needed.
+  bool hpass = hfilter[2] != 128, vpass = vfilter[2] != 128;
+  size_t first = vpass ? 0 : 2, last = vpass ? height + 5 : height + 2;
+  Taps8 htaps(hfilter);
+  __m128i tmp[16 + 5];
+  for (size_t i = first; i < last; ++i) {
+    const uint8_t *row = src + i * src_stride;
+    if (!hpass) {
+      tmp[i] = width == 16 ? Load16(row) : Load8(row);
+      continue;
+    }
+#if VP8_DSP_LEVEL >= 2  // CPU_AVX2
+    if (width == 16) {
+      tmp[i] = HorizontalSixtap16(row - 2, htaps);
+      continue;
+    }
+#endif
+    __m128i lo = HorizontalSixtap8(row - 2, htaps);
+    __m128i hi = width == 16 ? HorizontalSixtap8(row + 6, htaps) : lo;
+    tmp[i] = _mm_packus_epi16(lo, hi);
+  }
+  if (!vpass) {
+    for (size_t i = 0; i < height; ++i) {
+      if (width == 16)
+        Store16(dst + i * dst_stride, tmp[i + 2]);
+      else
+        Store8(dst + i * dst_stride, tmp[i + 2]);
+    }
+    return;
+  }
+  Taps8 vtaps(vfilter);
+  for (size_t i = 0; i < height; ++i) {
+    uint8_t *row = dst + i * dst_stride;
+#if VP8_DSP_LEVEL >= 2  // CPU_AVX2
+    if (width == 16) {
+      Store16(row, VerticalSixtap16(tmp + i, vtaps));
+      continue;
+    }
+#endif
+    __m128i lo = VerticalSixtap8(tmp + i, false, vtaps);
+    __m128i hi = width == 16 ? VerticalSixtap8(tmp + i, true, vtaps) : lo;
+    if (width == 16)
+      Store16(row, _mm_packus_epi16(lo, hi));
+    else
+      Store8(row, _mm_packus_epi16(lo, lo));
+  }
+}
+#endif
+
+void Sixtap(const uint8_t *src, size_t src_stride, size_t width, size_t height,
+            const int16_t *hfilter, const int16_t *vfilter, uint8_t *dst,
+            size_t dst_stride) {
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+  if (width >= 8) {
+    SixtapWide(src - 2 * src_stride, src_stride, width, height, hfilter,
+               vfilter, dst, dst_stride);
+    return;
+  }
+#endif
+  src -= 2 * src_stride;
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+  // Pairs of taps are applied with _mm_madd_epi16 to interleaved pixels, the
+  // sums being kept in 32 bits.
+  __m128i round = _mm_set1_epi32(64), zero = _mm_setzero_si128();
+  __m128i h01 = TapPair(hfilter, 0), h23 = TapPair(hfilter, 2),
+          h45 = TapPair(hfilter, 4);
+  __m128i tmp[16 + 5];
+  for (size_t i = 0; i < height + 5; ++i) {
+    const uint8_t *row = src + i * src_stride - 2;
+    // Lane j of x[k] is row[j + k].
+    __m128i x[6];
+    for (size_t k = 0; k < 6; ++k) x[k] = _mm_cvtepu8_epi16(Load4(row + k));
+    __m128i sum = _mm_add_epi32(
+        _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x[0], x[1]), h01),
+                      _mm_madd_epi16(_mm_unpacklo_epi16(x[2], x[3]), h23)),
+        _mm_madd_epi16(_mm_unpacklo_epi16(x[4], x[5]), h45));
+    sum = _mm_srai_epi32(_mm_add_epi32(sum, round), 7);
+    __m128i clamped = _mm_packs_epi32(sum, sum);
+    tmp[i] = _mm_min_epi16(_mm_max_epi16(clamped, zero), _mm_set1_epi16(255));
+  }
+  __m128i v01 = TapPair(vfilter, 0), v23 = TapPair(vfilter, 2),
+          v45 = TapPair(vfilter, 4);
+  for (size_t i = 0; i < height; ++i) {
+    __m128i sum = _mm_add_epi32(
+        _mm_add_epi32(
+            _mm_madd_epi16(_mm_unpacklo_epi16(tmp[i], tmp[i + 1]), v01),
+            _mm_madd_epi16(_mm_unpacklo_epi16(tmp[i + 2], tmp[i + 3]), v23)),
+        _mm_madd_epi16(_mm_unpacklo_epi16(tmp[i + 4], tmp[i + 5]), v45));
+    sum = _mm_srai_epi32(_mm_add_epi32(sum, round), 7);
+    __m128i packed = _mm_packs_epi32(sum, sum);
+    Store4(dst + i * dst_stride, _mm_packus_epi16(packed, packed));
+  }
+#else
+  int16_t tmp[16 + 5][16];
+  for (size_t i = 0; i < height + 5; ++i) {
+    const uint8_t *row = src + i * src_stride - 2;
+    for (size_t j = 0; j < width; ++j) {
+      int32_t sum = row[j + 0] * hfilter[0] + row[j + 1] * hfilter[1] +
+                    row[j + 2] * hfilter[2] + row[j + 3] * hfilter[3] +
+                    row[j + 4] * hfilter[4] + row[j + 5] * hfilter[5];
+      tmp[i][j] = Clamp(int16_t((sum + 64) >> 7));
+    }
+  }
+  for (size_t i = 0; i < height; ++i) {
+    uint8_t *row = dst + i * dst_stride;
+    for (size_t j = 0; j < width; ++j) {
+      int32_t sum = int32_t(tmp[i + 0][j]) * vfilter[0] +
+                    int32_t(tmp[i + 1][j]) * vfilter[1] +
+                    int32_t(tmp[i + 2][j]) * vfilter[2] +
+                    int32_t(tmp[i + 3][j]) * vfilter[3] +
+                    int32_t(tmp[i + 4][j]) * vfilter[4] +
+                    int32_t(tmp[i + 5][j]) * vfilter[5];
+      row[j] = uint8_t(Clamp(int16_t((sum + 64) >> 7)));
+    }
+  }
+#endif
+}
+
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+// The rounded sums of the low 8 pixels (high if hi) of a and b, weighted by the
+// pair of taps, as int16_t.
+inline __m128i Bilinear8(__m128i a, __m128i b, bool hi, __m128i taps) {
+  __m128i pairs = hi ? _mm_unpackhi_epi8(a, b) : _mm_unpacklo_epi8(a, b);
+  return _mm_srai_epi16(
+      _mm_add_epi16(_mm_maddubs_epi16(pairs, taps), _mm_set1_epi16(64)), 7);
+}
+#endif
+
+void Bilinear(const uint8_t *src, size_t src_stride, size_t width,
+              size_t height, const int16_t *hfilter, const int16_t *vfilter,
+              uint8_t *dst, size_t dst_stride) {
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+  // Pixels j and j + 1 are interleaved for _mm_maddubs_epi16; the sums stay
+  // below 128 * 255. As in SixtapWide, the pass of a whole-pixel filter (whose
+  // 128 would not fit in 8 bits) is skipped.
+  bool hpass = hfilter[2] != 128, vpass = vfilter[2] != 128;
+  auto load = [width](const uint8_t *p) {
+    return width == 16 ? Load16(p) : width == 8 ? Load8(p) : Load4(p);
+  };
+  auto filter = [width](__m128i a, __m128i b, __m128i taps) {
+    __m128i lo = Bilinear8(a, b, false, taps);
+    return _mm_packus_epi16(lo, width == 16 ? Bilinear8(a, b, true, taps) : lo);
+  };
+  __m128i htaps = TapPair8(hfilter, 2, 3), vtaps = TapPair8(vfilter, 2, 3);
+  __m128i tmp[16 + 1];
+  for (size_t i = 0; i < (vpass ? height + 1 : height); ++i) {
+    const uint8_t *row = src + i * src_stride;
+    tmp[i] = hpass ? filter(load(row), load(row + 1), htaps) : load(row);
+  }
+  for (size_t i = 0; i < height; ++i) {
+    __m128i out = vpass ? filter(tmp[i], tmp[i + 1], vtaps) : tmp[i];
+    uint8_t *row = dst + i * dst_stride;
+    if (width == 16)
+      Store16(row, out);
+    else if (width == 8)
+      Store8(row, out);
+    else
+      Store4(row, out);
+  }
+#else
+  int16_t tmp[16 + 1][16];
+  for (size_t i = 0; i < height + 1; ++i) {
+    const uint8_t *row = src + i * src_stride;
+    for (size_t j = 0; j < width; ++j)
+      tmp[i][j] =
+          int16_t((row[j] * hfilter[2] + row[j + 1] * hfilter[3] + 64) >> 7);
+  }
+  for (size_t i = 0; i < height; ++i) {
+    uint8_t *row = dst + i * dst_stride;
+    for (size_t j = 0; j < width; ++j)
+      row[j] = uint8_t(
+          (tmp[i][j] * vfilter[2] + tmp[i + 1][j] * vfilter[3] + 64) >> 7);
+  }
+#endif
+}
+
+// The sum of the size (8 or 16) pixels at src.
+inline uint32_t SumRow(const uint8_t *src, size_t size) {
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+  __m128i sad = _mm_sad_epu8(size == 16 ? Load16(src) : Load8(src),
+                             _mm_setzero_si128());
+  return uint32_t(_mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4));
+#else
+  uint32_t sum = 0;
+  for (size_t i = 0; i < size; ++i) sum += src[i];
+  return sum;
+#endif
+}
+
+inline void FillBlock(uint8_t value, size_t size, uint8_t *dst,
+                      size_t stride) {
+  for (size_t i = 0; i < size; ++i) std::memset(dst + i * stride, value, size);
+}
+
+template <size_t kSize>
+void VPred(uint8_t *dst, size_t stride) {
+  uint8_t above[kSize];
+  std::memcpy(above, dst - stride, kSize);
+  for (size_t i = 0; i < kSize; ++i)
+    std::memcpy(dst + i * stride, above, kSize);
+}
+
+template <size_t kSize>
+void HPred(uint8_t *dst, size_t stride) {
+  for (size_t i = 0; i < kSize; ++i) {
+    uint8_t *row = dst + i * stride;
+    std::memset(row, row[-1], kSize);
+  }
+}
+
+// DC prediction from the row above if kTop and the column to the left if
+// kLeft, or 128 if neither.
+template <size_t kSize, bool kTop, bool kLeft>
+void DCPred(uint8_t *dst, size_t stride) {
+  constexpr uint32_t kShift = (kSize == 16 ? 4 : 3) + (kTop && kLeft);
+  uint32_t sum = 0;
+  if (kTop) sum += SumRow(dst - stride, kSize);
+  if (kLeft) {
+    for (size_t i = 0; i < kSize; ++i) sum += dst[i * stride - 1];
+  }
+  uint8_t value = kTop || kLeft
+                      ? uint8_t((sum + (1u << (kShift - 1))) >> kShift)
+                      : 128;
+  FillBlock(value, kSize, dst, stride);
+}
+
+// TrueMotion prediction of the size x size block at dst (size being 4, 8 or
+// 16) from the size pixels at above, above[-1] and the column to its left.
+void TrueMotion(const uint8_t *above, size_t size, uint8_t *dst,
+                size_t stride) {
+#if VP8_DSP_LEVEL >= 2  // CPU_AVX2
+  if (size == 16) {
+    // A whole row per register.
+    __m256i base = _mm256_sub_epi16(_mm256_cvtepu8_epi16(Load16(above)),
+                                    _mm256_set1_epi16(above[-1]));
+    for (size_t i = 0; i < 16; ++i) {
+      uint8_t *row = dst + i * stride;
+      __m256i sum = _mm256_add_epi16(base, _mm256_set1_epi16(row[-1]));
+      __m128i packed = _mm_packus_epi16(_mm256_castsi256_si128(sum),
+                                        _mm256_extracti128_si256(sum, 1));
+      Store16(row, packed);
+    }
+    return;
+  }
+#endif
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+  // Eight pixels per register; the sums fit in 16 bits and packing clamps
+  // them.
+  __m128i corner = _mm_set1_epi16(above[-1]);
+  for (size_t j = 0; j < size; j += 8) {
+    __m128i pixels = size == 4 ? Load4(above) : Load8(above + j);
+    __m128i base = _mm_sub_epi16(_mm_cvtepu8_epi16(pixels), corner);
+    for (size_t i = 0; i < size; ++i) {
+      uint8_t *row = dst + i * stride;
+      __m128i sum = _mm_add_epi16(base, _mm_set1_epi16(row[-1]));
+      __m128i packed = _mm_packus_epi16(sum, sum);
+      if (size == 4)
+        Store4(row, packed);
+      else
+        Store8(row + j, packed);
+    }
+  }
+#else
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t *row = dst + i * stride;
+    for (size_t j = 0; j < size; ++j)
+      row[j] = uint8_t(Clamp(int16_t(row[-1] + above[j] - above[-1])));
+  }
+#endif
+}
+
+template <size_t kSize>
+void TMPred(uint8_t *dst, size_t stride) {
+  TrueMotion(dst - stride, kSize, dst, stride);
+}
+
+void BPredDC(const uint8_t *above, uint8_t *dst, size_t stride) {
+  uint32_t sum = 4;
+  for (size_t i = 0; i < 4; ++i) sum += above[i] + dst[i * stride - 1];
+  FillBlock(uint8_t(sum >> 3), 4, dst, stride);
+}
+
+void BPredTM(const uint8_t *above, uint8_t *dst, size_t stride) {
+  TrueMotion(above, 4, dst, stride);
+}
+
+// The other subblock modes only pick pixels, row by row, among the averages
+// of the 16 pixels of the edge of the subblock, from its bottom-left pixel to
+// its above-right one:
+//
+//   L3 L3 L2 L1 L0 P A0 A1 A2 A3 A4 A5 A6 A7 A7 A7
+//
+// (L being the column to the left, P the above-left pixel and A the row above;
+// the pixels at both ends are repeated as the modes do). Lane k of the table
+// stands for (e[k - 1] + 2 * e[k] + e[k + 1] + 2) >> 2 and lane 16 + k for
+// (e[k] + e[k + 1] + 1) >> 1, e being the edge.
+constexpr uint8_t kBPredLanes[kNumIntraBModes - B_VE_PRED][16] = {
+    // B_VE_PRED
+    {6, 7, 8, 9, 6, 7, 8, 9, 6, 7, 8, 9, 6, 7, 8, 9},
+    // B_HE_PRED
+    {4, 4, 4, 4, 3, 3, 3, 3, 2, 2, 2, 2, 1, 1, 1, 1},
+    // B_LD_PRED
+    {7, 8, 9, 10, 8, 9, 10, 11, 9, 10, 11, 12, 10, 11, 12, 13},
+    // B_RD_PRED
+    {5, 6, 7, 8, 4, 5, 6, 7, 3, 4, 5, 6, 2, 3, 4, 5},
+    // B_VR_PRED
+    {21, 22, 23, 24, 5, 6, 7, 8, 4, 21, 22, 23, 3, 5, 6, 7},
+    // B_VL_PRED
+    {22, 23, 24, 25, 7, 8, 9, 10, 23, 24, 25, 11, 8, 9, 10, 12},
+    // B_HD_PRED
+    {20, 5, 6, 7, 19, 4, 20, 5, 18, 3, 19, 4, 17, 2, 18, 3},
+    // B_HU_PRED
+    {19, 3, 18, 2, 18, 2, 17, 1, 17, 1, 16, 16, 16, 16, 16, 16},
+};
+
+template <size_t kMode>
+void BPredDirectional(const uint8_t *above, uint8_t *dst, size_t stride) {
+  const uint8_t *lanes = kBPredLanes[kMode - B_VE_PRED];
+  uint8_t l0 = dst[-1], l1 = dst[stride - 1], l2 = dst[2 * stride - 1],
+          l3 = dst[3 * stride - 1];
+#if VP8_DSP_LEVEL >= 1  // CPU_SSE41
+  __m128i edge = _mm_slli_si128(Load8(above), 6);
+  edge = _mm_insert_epi16(edge, l0 | above[-1] << 8, 2);
+  edge = _mm_insert_epi16(edge, above[7] * 0x101, 7);
+  edge = _mm_or_si128(edge, _mm_cvtsi32_si128(l3 | l3 << 8 | l2 << 16 |
+                                              int32_t(uint32_t(l1) << 24)));
+  __m128i prev = _mm_slli_si128(edge, 1), next = _mm_srli_si128(edge, 1);
+  // (prev + 2 * edge + next + 2) >> 2 is the rounded average of edge and
+  // (prev + next) >> 1.
+  __m128i half =
+      _mm_sub_epi8(_mm_avg_epu8(prev, next),
+                   _mm_and_si128(_mm_xor_si128(prev, next), _mm_set1_epi8(1)));
+  __m128i avg3 = _mm_avg_epu8(half, edge), avg2 = _mm_avg_epu8(edge, next);
+  // The lanes from 16 on have their bit 7 set once shifted by 3 (and
+  // _mm_shuffle_epi8 only looks at their low 4 bits).
+  __m128i index = Load16(lanes);
+  __m128i out = _mm_blendv_epi8(_mm_shuffle_epi8(avg3, index),
+                                _mm_shuffle_epi8(avg2, index),
+                                _mm_slli_epi16(index, 3));
+  Store4(dst, out);
+  Store4(dst + stride, _mm_srli_si128(out, 4));
+  Store4(dst + 2 * stride, _mm_srli_si128(out, 8));
+  Store4(dst + 3 * stride, _mm_srli_si128(out, 12));
+#else
+  const uint8_t edge[16] = {
+      l3,       l3,       l2,       l1,       l0,       above[-1],
+      above[0], above[1], above[2], above[3], above[4], above[5],
+      above[6], above[7], above[7], above[7]};
+  uint8_t avg[32] = {};
+  for (size_t k = 0; k < 15; ++k) {
+    if (k > 0)
+      avg[k] = uint8_t((edge[k - 1] + 2 * edge[k] + edge[k + 1] + 2) >> 2);
+    avg[16 + k] = uint8_t((edge[k] + edge[k + 1] + 1) >> 1);
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    for (size_t j = 0; j < 4; ++j) dst[i * stride + j] = avg[lanes[i * 4 + j]];
+  }
+#endif
+}
+
+}  // namespace
+
+const DspKernels *VP8_DSP_KERNELS() {
+  static constexpr DspKernels kernels = {
+      kLevel,
+      DequantIDCTAdd,
+      AddDC,
+      Sixtap,
+      Bilinear,
+      {DCPred<16, true, true>, VPred<16>, HPred<16>, TMPred<16>,
+       DCPred<16, false, true>, DCPred<16, true, false>,
+       DCPred<16, false, false>},
+      {DCPred<8, true, true>, VPred<8>, HPred<8>, TMPred<8>,
+       DCPred<8, false, true>, DCPred<8, true, false>, DCPred<8, false, false>},
+      {BPredDC, BPredTM, BPredDirectional<B_VE_PRED>,
+       BPredDirectional<B_HE_PRED>, BPredDirectional<B_LD_PRED>,
+       BPredDirectional<B_RD_PRED>, BPredDirectional<B_VR_PRED>,
+       BPredDirectional<B_VL_PRED>, BPredDirectional<B_HD_PRED>,
+       BPredDirectional<B_HU_PRED>},
+      // The edge loop filter only needs SSE2, which every x86-64 CPU has; the
+      // scalar level keeps the pixel-by-pixel one.
+      kLevel != CPU_SCALAR};
+  return &kernels;
+}
+
+}  // namespace internal
+}  // namespace vp8
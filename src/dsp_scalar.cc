@@ -0,0 +1,5 @@
+// The kernels of CPU_SCALAR, built for the baseline instruction set.
+
+#define VP8_DSP_KERNELS ScalarKernels
+#define VP8_DSP_LEVEL 0
+#include "dsp_kernels.h"
@@ -0,0 +1,19 @@
+// The kernels of CPU_SSE41, built with -msse4.1 (see CMakeLists.txt and
+// the Makefile).
+
+#include "dsp.h"
+
+#if defined(__SSE4_1__)
+#define VP8_DSP_KERNELS Sse41Kernels
+#define VP8_DSP_LEVEL 1
+#include "dsp_kernels.h"
+#else
+namespace vp8 {
+namespace internal {
+
+// Not built for this architecture.
+const DspKernels *Sse41Kernels() { return nullptr; }
+
+}  // namespace internal
+}  // namespace vp8
+#endif
@@ -20,7 +20,7 @@ uint32_t GetPredictionError(const SubBlock &target, const SubBlock &predict) {
   uint32_t res = 0;
   for (size_t i = 0; i < 4; ++i) {
     for (size_t j = 0; j < 4; ++j) {
-      int32_t diff = target.at(i).at(j) - predict.at(i).at(j);
+      int32_t diff = target.GetPixel(i, j) - predict.GetPixel(i, j);
       res += uint32_t(diff * diff);
     }
   }
@@ -37,8 +37,8 @@ MacroBlockMode PickIntraModeChroma(size_t r, size_t c,
 
   VPredChroma(r, c, u_predict);
   VPredChroma(r, c, v_predict);
-  error = GetPredictionError(u_target, u_predict.at(r).at(c)) +
-          GetPredictionError(v_target, v_predict.at(r).at(c));
+  error = GetPredictionError(u_target, u_predict.at(r, c)) +
+          GetPredictionError(v_target, v_predict.at(r, c));
   if (error < best_error) {
     best_error = error;
     best_mode = V_PRED;
@@ -46,8 +46,8 @@ MacroBlockMode PickIntraModeChroma(size_t r, size_t c,
 
   HPredChroma(r, c, u_predict);
   HPredChroma(r, c, v_predict);
-  error = GetPredictionError(u_target, u_predict.at(r).at(c)) +
-          GetPredictionError(v_target, v_predict.at(r).at(c));
+  error = GetPredictionError(u_target, u_predict.at(r, c)) +
+          GetPredictionError(v_target, v_predict.at(r, c));
   if (error < best_error) {
     best_error = error;
     best_mode = H_PRED;
@@ -55,8 +55,8 @@ MacroBlockMode PickIntraModeChroma(size_t r, size_t c,
 
   DCPredChroma(r, c, u_predict);
   DCPredChroma(r, c, v_predict);
-  error = GetPredictionError(u_target, u_predict.at(r).at(c)) +
-          GetPredictionError(v_target, v_predict.at(r).at(c));
+  error = GetPredictionError(u_target, u_predict.at(r, c)) +
+          GetPredictionError(v_target, v_predict.at(r, c));
   if (error < best_error) {
     best_error = error;
     best_mode = DC_PRED;
@@ -64,8 +64,8 @@ MacroBlockMode PickIntraModeChroma(size_t r, size_t c,
 
   TMPredChroma(r, c, u_predict);
   TMPredChroma(r, c, v_predict);
-  error = GetPredictionError(u_target, u_predict.at(r).at(c)) +
-          GetPredictionError(v_target, v_predict.at(r).at(c));
+  error = GetPredictionError(u_target, u_predict.at(r, c)) +
+          GetPredictionError(v_target, v_predict.at(r, c));
   if (error < best_error) {
     best_error = error;
     best_mode = TM_PRED;
@@ -104,8 +104,8 @@ static SubBlockMode &operator++(SubBlockMode &mode) {
 }
 
 std::pair<SubBlockMode, uint32_t> PickIntraSubBlockModeSB(
-    const std::array<int16_t, 8> &above, const std::array<int16_t, 4> &left,
-    int16_t p, const SubBlock &target, SubBlock &predict) {
+    const std::array<uint8_t, 8> &above, const std::array<uint8_t, 4> &left,
+    uint8_t p, const SubBlock &target, const SubBlock &predict) {
   uint32_t best_error = UINT_MAX;
   SubBlockMode best_mode{};
 
@@ -124,75 +124,18 @@ std::pair<SubBlockMode, uint32_t> PickIntraSubBlockModeSB(
 uint32_t PickIntraSubBlockModeMB(size_t r, size_t c,
                                  const MacroBlock<4> &target, Plane<4> &predict,
                                  std::array<SubBlockMode, 16> &sub_mode) {
-  std::array<int16_t, 8> above{};
-  std::array<int16_t, 4> left{};
-  std::array<int16_t, 4> row_above{};
-  std::array<int16_t, 4> row_right{};
+  std::array<uint8_t, 8> above{};
+  std::array<uint8_t, 4> left{};
+  uint8_t p = 0;
 
   uint32_t error = 0;
 
   for (size_t i = 0; i < 4; ++i) {
     for (size_t j = 0; j < 4; ++j) {
-      if (i > 0) {
-        row_above = predict.at(r).at(c).at(i - 1).at(j).GetRow(3);
-      } else {
-        if (r == 0)
-          std::fill(row_above.begin(), row_above.end(), kUpperPixel);
-        else
-          row_above = predict.at(r - 1).at(c).at(3).at(j).GetRow(3);
-      }
-
-      if (j == 3) {
-        if (r == 0) {
-          std::fill(row_right.begin(), row_right.end(), kUpperPixel);
-        } else if (c + 1 == predict.at(r).size()) {
-          int16_t x = predict.at(r - 1).at(c).at(3).at(3).at(3).at(3);
-          std::fill(row_right.begin(), row_right.end(), x);
-        } else {
-          row_right = predict.at(r - 1).at(c + 1).at(3).at(0).GetRow(3);
-        }
-      } else {
-        if (i > 0) {
-          row_right = predict.at(r).at(c).at(i - 1).at(j + 1).GetRow(3);
-        } else {
-          if (r == 0)
-            std::fill(row_right.begin(), row_right.end(), kUpperPixel);
-          else
-            row_right = predict.at(r - 1).at(c).at(3).at(j + 1).GetRow(3);
-        }
-      }
-
-      std::copy(row_above.begin(), row_above.end(), above.begin());
-      std::copy(row_right.begin(), row_right.end(), above.begin() + 4);
-
-      if (j > 0) {
-        left = predict.at(r).at(c).at(i).at(j - 1).GetCol(3);
-      } else {
-        if (c == 0)
-          std::fill(left.begin(), left.end(), kLeftPixel);
-        else
-          left = predict.at(r).at(c - 1).at(i).at(3).GetCol(3);
-      }
-
-      int16_t p = 0;
-      if (i > 0 && j > 0)
-        p = predict.at(r).at(c).at(i - 1).at(j - 1).at(3).at(3);
-      else if (i > 0)
-        p = c == 0 ? kLeftPixel : predict.at(r).at(c - 1).at(i - 1).at(3).at(3).at(3);
-      else if (j > 0)
-        p = r == 0 ? kUpperPixel : predict.at(r - 1).at(c).at(3).at(j - 1).at(3).at(3);
-      else
-        p = r == 0 && c == 0
-                ? kUpperPixel
-                : r == 0
-                      ? kUpperPixel
-                      : c == 0
-                            ? kLeftPixel
-                            : predict.at(r - 1).at(c - 1).at(3).at(3).at(3).at(
-                                  3);
+      BPredEdges(r, c, i, j, predict, above, left, p);
 
       std::pair<SubBlockMode, uint32_t> info = PickIntraSubBlockModeSB(
-          above, left, p, target.at(i).at(j), predict.at(r).at(c).at(i).at(j));
+          above, left, p, target.at(i, j), predict.at(r, c).at(i, j));
 
       error += info.second;
       sub_mode.at(i << 2 | j) = info.first;
@@ -208,28 +151,28 @@ MacroBlockMode PickIntraModeLuma(size_t r, size_t c,
   uint32_t best_error = UINT_MAX, error = 0;
 
   VPredLuma(r, c, predict);
-  error = GetPredictionError(target, predict.at(r).at(c));
+  error = GetPredictionError(target, predict.at(r, c));
   if (error < best_error) {
     best_error = error;
     best_mode = V_PRED;
   }
 
   HPredLuma(r, c, predict);
-  error = GetPredictionError(target, predict.at(r).at(c));
+  error = GetPredictionError(target, predict.at(r, c));
   if (error < best_error) {
     best_error = error;
     best_mode = H_PRED;
   }
 
   DCPredLuma(r, c, predict);
-  error = GetPredictionError(target, predict.at(r).at(c));
+  error = GetPredictionError(target, predict.at(r, c));
   if (error < best_error) {
     best_error = error;
     best_mode = DC_PRED;
   }
 
   TMPredLuma(r, c, predict);
-  error = GetPredictionError(target, predict.at(r).at(c));
+  error = GetPredictionError(target, predict.at(r, c));
   if (error < best_error) {
     best_error = error;
     best_mode = TM_PRED;
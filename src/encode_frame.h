@@ -26,8 +26,8 @@ MacroBlockMode PickIntraModeChroma(size_t r, size_t c,
 // Select prediction mode for subblock and return a pair consisting of the
 // selected mode and the corresponding cost.
 std::pair<SubBlockMode, uint32_t> PickIntraSubBlockModeSB(
-    const std::array<int16_t, 8> &above, const std::array<int16_t, 4> &left,
-    int16_t p, const SubBlock &target, SubBlock &predict);
+    const std::array<uint8_t, 8> &above, const std::array<uint8_t, 4> &left,
+    uint8_t p, const SubBlock &target, const SubBlock &predict);
 
 // For each of the 16 subblocks, find the best prediction mode and store them in
 // sub_mode. Return the total cost.
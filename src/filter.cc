@@ -1,118 +1,368 @@
 #include "filter.h"
 
+#include "dsp.h"
+
 namespace vp8 {
 namespace internal {
 namespace filter {
 
-inline bool IsFilterNormal(int16_t interior, int16_t edge) {
-  return ((abs(p0_ - q0_) << 1) + (abs(p1_ - q1_) >> 1)) <= edge &&
-         abs(p3_ - p2_) <= interior && abs(p2_ - p1_) <= interior &&
-         abs(p1_ - p0_) <= interior && abs(q0_ - q1_) <= interior &&
-         abs(q1_ - q2_) <= interior && abs(q2_ - q3_) <= interior;
+inline bool IsFilterNormal(const EdgePixels &e, int16_t interior,
+                           int16_t edge) {
+  return ((abs(e.p0 - e.q0) << 1) + (abs(e.p1 - e.q1) >> 1)) <= edge &&
+         abs(e.p3 - e.p2) <= interior && abs(e.p2 - e.p1) <= interior &&
+         abs(e.p1 - e.p0) <= interior && abs(e.q0 - e.q1) <= interior &&
+         abs(e.q1 - e.q2) <= interior && abs(e.q2 - e.q3) <= interior;
 }
 
-inline bool IsFilterSimple(int16_t edge) {
-  return (abs(p0_ - q0_) << 1) + (abs(p1_ - q1_) >> 1) <= edge;
+inline bool IsFilterSimple(const EdgePixels &e, int16_t edge) {
+  return (abs(e.p0 - e.q0) << 1) + (abs(e.p1 - e.q1) >> 1) <= edge;
 }
 
-inline bool IsHighVariance(int16_t threshold) {
-  return abs(p1_ - p0_) > threshold || abs(q1_ - q0_) > threshold;
+inline bool IsHighVariance(const EdgePixels &e, int16_t threshold) {
+  return abs(e.p1 - e.p0) > threshold || abs(e.q1 - e.q0) > threshold;
 }
 
-void Adjust(bool use_outer_taps) {
-  int16_t a = int16_t(
-      Clamp128((use_outer_taps ? Clamp128(p1_ - q1_) : 0) + 3 * (q0_ - p0_)));
+void Adjust(EdgePixels &e, bool use_outer_taps) {
+  int16_t a = int16_t(Clamp128((use_outer_taps ? Clamp128(e.p1 - e.q1) : 0) +
+                                3 * (e.q0 - e.p0)));
 
   int16_t f1 = ((a + 4 > 127) ? 127 : a + 4) >> 3;
   int16_t f2 = ((a + 3 > 127) ? 127 : a + 3) >> 3;
 
-  p0_ = Clamp255(int16_t(p0_ + f2));
-  q0_ = Clamp255(int16_t(q0_ - f1));
+  e.p0 = Clamp255(int16_t(e.p0 + f2));
+  e.q0 = Clamp255(int16_t(e.q0 - f1));
 
   if (!use_outer_taps) {
     a = (f1 + 1) >> 1;
-    p1_ = Clamp255(int16_t(p1_ + a));
-    q1_ = Clamp255(int16_t(q1_ - a));
+    e.p1 = Clamp255(int16_t(e.p1 + a));
+    e.q1 = Clamp255(int16_t(e.q1 - a));
   }
 }
 
-void SubBlockFilter(int16_t hev_threshold, int16_t interior_limit,
-                    int16_t edge_limit) {
-  if (!IsFilterNormal(interior_limit, edge_limit)) return;
-  bool hv = IsHighVariance(hev_threshold);
-  Adjust(hv);
+void SubBlockFilter(EdgePixels &e, int16_t hev_threshold,
+                    int16_t interior_limit, int16_t edge_limit) {
+  if (!IsFilterNormal(e, interior_limit, edge_limit)) return;
+  bool hv = IsHighVariance(e, hev_threshold);
+  Adjust(e, hv);
 }
 
-void MacroBlockFilter(int16_t hev_threshold, int16_t interior_limit,
-                      int16_t edge_limit) {
-  if (!IsFilterNormal(interior_limit, edge_limit)) return;
+void MacroBlockFilter(EdgePixels &e, int16_t hev_threshold,
+                      int16_t interior_limit, int16_t edge_limit) {
+  if (!IsFilterNormal(e, interior_limit, edge_limit)) return;
 
-  if (!IsHighVariance(hev_threshold)) {
-    int16_t w = int16_t(Clamp128(Clamp128(p1_ - q1_) + 3 * (q0_ - p0_)));
+  if (!IsHighVariance(e, hev_threshold)) {
+    int16_t w = int16_t(Clamp128(Clamp128(e.p1 - e.q1) + 3 * (e.q0 - e.p0)));
 
     int16_t a = (int16_t(27) * w + int16_t(63)) >> 7;
-    q0_ = Clamp255(int16_t(q0_ - a));
-    p0_ = Clamp255(int16_t(p0_ + a));
+    e.q0 = Clamp255(int16_t(e.q0 - a));
+    e.p0 = Clamp255(int16_t(e.p0 + a));
 
     a = (int16_t(18) * w + int16_t(63)) >> 7;
-    q1_ = Clamp255(int16_t(q1_ - a));
-    p1_ = Clamp255(int16_t(p1_ + a));
+    e.q1 = Clamp255(int16_t(e.q1 - a));
+    e.p1 = Clamp255(int16_t(e.p1 + a));
 
     a = (int16_t(9) * w + int16_t(63)) >> 7;
-    q2_ = Clamp255(int16_t(q2_ - a));
-    p2_ = Clamp255(int16_t(p2_ + a));
+    e.q2 = Clamp255(int16_t(e.q2 - a));
+    e.p2 = Clamp255(int16_t(e.p2 + a));
   } else {
-    Adjust(true);
+    Adjust(e, true);
+  }
+}
+
+void SimpleFilter(EdgePixels &e, int16_t limit) {
+  if (IsFilterSimple(e, limit)) Adjust(e, true);
+}
+
+EdgePixels InitHorizontal(const uint8_t *q0) {
+  return {q0[-4], q0[-3], q0[-2], q0[-1], q0[0], q0[1], q0[2], q0[3]};
+}
+
+void FillHorizontal(const EdgePixels &e, uint8_t *q0) {
+  q0[-4] = uint8_t(e.p3);
+  q0[-3] = uint8_t(e.p2);
+  q0[-2] = uint8_t(e.p1);
+  q0[-1] = uint8_t(e.p0);
+  q0[0] = uint8_t(e.q0);
+  q0[1] = uint8_t(e.q1);
+  q0[2] = uint8_t(e.q2);
+  q0[3] = uint8_t(e.q3);
+}
+
+EdgePixels InitVertical(const uint8_t *q0, size_t stride) {
+  return {*(q0 - 4 * stride), *(q0 - 3 * stride), *(q0 - 2 * stride),
+          *(q0 - stride),     q0[0],              q0[stride],
+          q0[2 * stride],     q0[3 * stride]};
+}
+
+void FillVertical(const EdgePixels &e, uint8_t *q0, size_t stride) {
+  *(q0 - 4 * stride) = uint8_t(e.p3);
+  *(q0 - 3 * stride) = uint8_t(e.p2);
+  *(q0 - 2 * stride) = uint8_t(e.p1);
+  *(q0 - stride) = uint8_t(e.p0);
+  q0[0] = uint8_t(e.q0);
+  q0[stride] = uint8_t(e.q1);
+  q0[2 * stride] = uint8_t(e.q2);
+  q0[3 * stride] = uint8_t(e.q3);
+}
+
+#ifdef __SSE2__
+namespace {
+
+inline __m128i Load8(const uint8_t *p) {
+  return _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+}
+
+inline void Store8(uint8_t *p, __m128i v) {
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(p), v);
+}
+
+// Lanes 0-7 from lo and lanes 8-15 from hi.
+inline __m128i Load16(const uint8_t *lo, const uint8_t *hi) {
+  if (hi == lo + 8)
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(lo));
+  return _mm_unpacklo_epi64(Load8(lo), Load8(hi));
+}
+
+inline void Store16(uint8_t *lo, uint8_t *hi, __m128i v) {
+  if (hi == lo + 8) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lo), v);
+    return;
+  }
+  Store8(lo, v);
+  Store8(hi, _mm_unpackhi_epi64(v, v));
+}
+
+inline __m128i AbsDiff(__m128i a, __m128i b) {
+  return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+// 0xff in the lanes where x <= limit (unsigned).
+inline __m128i LessEqual(__m128i x, __m128i limit) {
+  return _mm_cmpeq_epi8(_mm_subs_epu8(x, limit), _mm_setzero_si128());
+}
+
+// |p0 - q0| * 2 + |p1 - q1| / 2 with unsigned saturation, which is exact for
+// the comparisons since every edge limit is below 256.
+inline __m128i EdgeDiff(const EdgeVectors &e) {
+  __m128i d0 = AbsDiff(e.p0, e.q0);
+  __m128i d1 = _mm_and_si128(_mm_srli_epi16(AbsDiff(e.p1, e.q1), 1),
+                             _mm_set1_epi8(0x7f));
+  return _mm_adds_epu8(_mm_adds_epu8(d0, d0), d1);
+}
+
+inline __m128i NormalMask(const EdgeVectors &e, uint8_t interior,
+                          uint8_t edge) {
+  __m128i m = _mm_max_epu8(AbsDiff(e.p3, e.p2), AbsDiff(e.p2, e.p1));
+  m = _mm_max_epu8(m, AbsDiff(e.p1, e.p0));
+  m = _mm_max_epu8(m, AbsDiff(e.q0, e.q1));
+  m = _mm_max_epu8(m, AbsDiff(e.q1, e.q2));
+  m = _mm_max_epu8(m, AbsDiff(e.q2, e.q3));
+  return _mm_and_si128(LessEqual(m, _mm_set1_epi8(char(interior))),
+                       LessEqual(EdgeDiff(e), _mm_set1_epi8(char(edge))));
+}
+
+inline __m128i HighVariance(const EdgeVectors &e, uint8_t threshold) {
+  __m128i m = _mm_max_epu8(AbsDiff(e.p1, e.p0), AbsDiff(e.q1, e.q0));
+  return _mm_xor_si128(LessEqual(m, _mm_set1_epi8(char(threshold))),
+                       _mm_set1_epi8(char(0xff)));
+}
+
+// Convert between pixels and signed pixels (x - 128), on which saturating
+// signed arithmetic gives the clamping of the scalar filters.
+inline __m128i FlipSign(__m128i x) {
+  return _mm_xor_si128(x, _mm_set1_epi8(char(0x80)));
+}
+
+// Arithmetic right shift of signed bytes.
+template <int S>
+inline __m128i ShiftRight(__m128i x) {
+  __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8 + S);
+  __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8 + S);
+  return _mm_packs_epi16(lo, hi);
+}
+
+// Clamp128(base + 3 * (q0 - p0)); adding the clamped difference three times
+// with saturation reaches the same value since the clamps are monotonic.
+inline __m128i FilterValue(__m128i base, __m128i ps0, __m128i qs0) {
+  __m128i d = _mm_subs_epi8(qs0, ps0);
+  base = _mm_adds_epi8(base, d);
+  base = _mm_adds_epi8(base, d);
+  return _mm_adds_epi8(base, d);
+}
+
+// The common adjustment of p0 and q0, returning f1.
+inline __m128i AdjustCenter(__m128i a, __m128i &ps0, __m128i &qs0) {
+  __m128i f1 = ShiftRight<3>(_mm_adds_epi8(a, _mm_set1_epi8(4)));
+  __m128i f2 = ShiftRight<3>(_mm_adds_epi8(a, _mm_set1_epi8(3)));
+  qs0 = _mm_subs_epi8(qs0, f1);
+  ps0 = _mm_adds_epi8(ps0, f2);
+  return f1;
+}
+
+// (k * w + 63) >> 7 for the macroblock filter taps.
+inline __m128i Tap(__m128i w, int16_t k) {
+  const __m128i kMul = _mm_set1_epi16(k), kRound = _mm_set1_epi16(63);
+  __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+  __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+  lo = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, kMul), kRound), 7);
+  hi = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, kMul), kRound), 7);
+  return _mm_packs_epi16(lo, hi);
+}
+
+}  // namespace
+
+void LoadVerticalEdge(const uint8_t *lo, const uint8_t *hi, size_t stride,
+                      EdgeVectors &e) {
+  // Transpose 16 rows of p3, ..., q3 into 8 vectors of 16 lanes.
+  __m128i r[16];
+  for (size_t i = 0; i < 8; i++) {
+    r[i] = Load8(lo + i * stride - 4);
+    r[i + 8] = Load8(hi + i * stride - 4);
+  }
+  __m128i a[8], b[8], c[8];
+  for (size_t i = 0; i < 8; i++)
+    a[i] = _mm_unpacklo_epi8(r[2 * i], r[2 * i + 1]);
+  for (size_t i = 0; i < 4; i++) {
+    b[2 * i] = _mm_unpacklo_epi16(a[2 * i], a[2 * i + 1]);
+    b[2 * i + 1] = _mm_unpackhi_epi16(a[2 * i], a[2 * i + 1]);
+  }
+  // b[2g] holds columns 0-3 and b[2g + 1] columns 4-7 of rows 4g to 4g + 3.
+  for (size_t i = 0; i < 2; i++) {
+    c[4 * i] = _mm_unpacklo_epi32(b[4 * i], b[4 * i + 2]);
+    c[4 * i + 1] = _mm_unpackhi_epi32(b[4 * i], b[4 * i + 2]);
+    c[4 * i + 2] = _mm_unpacklo_epi32(b[4 * i + 1], b[4 * i + 3]);
+    c[4 * i + 3] = _mm_unpackhi_epi32(b[4 * i + 1], b[4 * i + 3]);
+  }
+  // c[4h + k] holds columns 2k and 2k + 1 of rows 8h to 8h + 7.
+  e.p3 = _mm_unpacklo_epi64(c[0], c[4]);
+  e.p2 = _mm_unpackhi_epi64(c[0], c[4]);
+  e.p1 = _mm_unpacklo_epi64(c[1], c[5]);
+  e.p0 = _mm_unpackhi_epi64(c[1], c[5]);
+  e.q0 = _mm_unpacklo_epi64(c[2], c[6]);
+  e.q1 = _mm_unpackhi_epi64(c[2], c[6]);
+  e.q2 = _mm_unpacklo_epi64(c[3], c[7]);
+  e.q3 = _mm_unpackhi_epi64(c[3], c[7]);
+}
+
+void StoreVerticalEdge(uint8_t *lo, uint8_t *hi, size_t stride,
+                       const EdgeVectors &e) {
+  // Pairs of columns for rows 0-7 (lo) and 8-15 (hi).
+  __m128i a[8] = {
+      _mm_unpacklo_epi8(e.p3, e.p2), _mm_unpackhi_epi8(e.p3, e.p2),
+      _mm_unpacklo_epi8(e.p1, e.p0), _mm_unpackhi_epi8(e.p1, e.p0),
+      _mm_unpacklo_epi8(e.q0, e.q1), _mm_unpackhi_epi8(e.q0, e.q1),
+      _mm_unpacklo_epi8(e.q2, e.q3), _mm_unpackhi_epi8(e.q2, e.q3)};
+  for (size_t h = 0; h < 2; h++) {
+    // Columns 0-3 and 4-7 of rows 8h to 8h + 3 and 8h + 4 to 8h + 7.
+    __m128i p_lo = _mm_unpacklo_epi16(a[h], a[h + 2]);
+    __m128i p_hi = _mm_unpackhi_epi16(a[h], a[h + 2]);
+    __m128i q_lo = _mm_unpacklo_epi16(a[h + 4], a[h + 6]);
+    __m128i q_hi = _mm_unpackhi_epi16(a[h + 4], a[h + 6]);
+    __m128i rows[4] = {
+        _mm_unpacklo_epi32(p_lo, q_lo), _mm_unpackhi_epi32(p_lo, q_lo),
+        _mm_unpacklo_epi32(p_hi, q_hi), _mm_unpackhi_epi32(p_hi, q_hi)};
+    uint8_t *base = (h == 0 ? lo : hi) - 4;
+    for (size_t i = 0; i < 4; i++) {
+      Store8(base + (2 * i) * stride, rows[i]);
+      Store8(base + (2 * i + 1) * stride, _mm_unpackhi_epi64(rows[i], rows[i]));
+    }
   }
 }
 
-void SimpleFilter(int16_t limit) {
-  if (IsFilterSimple(limit)) Adjust(true);
+void LoadHorizontalEdge(const uint8_t *lo, const uint8_t *hi, size_t stride,
+                        EdgeVectors &e) {
+  const ptrdiff_t s = ptrdiff_t(stride);
+  e.p3 = Load16(lo - 4 * s, hi - 4 * s);
+  e.p2 = Load16(lo - 3 * s, hi - 3 * s);
+  e.p1 = Load16(lo - 2 * s, hi - 2 * s);
+  e.p0 = Load16(lo - s, hi - s);
+  e.q0 = Load16(lo, hi);
+  e.q1 = Load16(lo + s, hi + s);
+  e.q2 = Load16(lo + 2 * s, hi + 2 * s);
+  e.q3 = Load16(lo + 3 * s, hi + 3 * s);
 }
 
-void InitHorizontal(const SubBlock &lsb, const SubBlock &rsb, size_t idx) {
-  p3_ = lsb.at(idx).at(0);
-  p2_ = lsb.at(idx).at(1);
-  p1_ = lsb.at(idx).at(2);
-  p0_ = lsb.at(idx).at(3);
-  q0_ = rsb.at(idx).at(0);
-  q1_ = rsb.at(idx).at(1);
-  q2_ = rsb.at(idx).at(2);
-  q3_ = rsb.at(idx).at(3);
+void StoreHorizontalEdge(uint8_t *lo, uint8_t *hi, size_t stride,
+                         const EdgeVectors &e) {
+  // None of the filters modify p3 and q3.
+  const ptrdiff_t s = ptrdiff_t(stride);
+  Store16(lo - 3 * s, hi - 3 * s, e.p2);
+  Store16(lo - 2 * s, hi - 2 * s, e.p1);
+  Store16(lo - s, hi - s, e.p0);
+  Store16(lo, hi, e.q0);
+  Store16(lo + s, hi + s, e.q1);
+  Store16(lo + 2 * s, hi + 2 * s, e.q2);
 }
 
-void FillHorizontal(SubBlock &lsb, SubBlock &rsb, size_t idx) {
-  lsb.at(idx).at(0) = p3_;
-  lsb.at(idx).at(1) = p2_;
-  lsb.at(idx).at(2) = p1_;
-  lsb.at(idx).at(3) = p0_;
-  rsb.at(idx).at(0) = q0_;
-  rsb.at(idx).at(1) = q1_;
-  rsb.at(idx).at(2) = q2_;
-  rsb.at(idx).at(3) = q3_;
+void SubBlockFilter(EdgeVectors &e, uint8_t hev_threshold,
+                    uint8_t interior_limit, uint8_t edge_limit) {
+  __m128i mask = NormalMask(e, interior_limit, edge_limit);
+  __m128i hev = HighVariance(e, hev_threshold);
+  __m128i ps1 = FlipSign(e.p1), ps0 = FlipSign(e.p0);
+  __m128i qs0 = FlipSign(e.q0), qs1 = FlipSign(e.q1);
+
+  // The outer taps are only used on high-variance pixels.
+  __m128i a = _mm_and_si128(_mm_subs_epi8(ps1, qs1), hev);
+  a = _mm_and_si128(FilterValue(a, ps0, qs0), mask);
+  __m128i f1 = AdjustCenter(a, ps0, qs0);
+
+  // (f1 + 1) >> 1 on p1 and q1 elsewhere; f1 is small enough not to saturate.
+  a = ShiftRight<1>(_mm_adds_epi8(f1, _mm_set1_epi8(1)));
+  a = _mm_andnot_si128(hev, a);
+  ps1 = _mm_adds_epi8(ps1, a);
+  qs1 = _mm_subs_epi8(qs1, a);
+
+  e.p1 = FlipSign(ps1);
+  e.p0 = FlipSign(ps0);
+  e.q0 = FlipSign(qs0);
+  e.q1 = FlipSign(qs1);
 }
 
-void InitVertical(const SubBlock &usb, const SubBlock &dsb, size_t idx) {
-  p3_ = usb.at(0).at(idx);
-  p2_ = usb.at(1).at(idx);
-  p1_ = usb.at(2).at(idx);
-  p0_ = usb.at(3).at(idx);
-  q0_ = dsb.at(0).at(idx);
-  q1_ = dsb.at(1).at(idx);
-  q2_ = dsb.at(2).at(idx);
-  q3_ = dsb.at(3).at(idx);
+void MacroBlockFilter(EdgeVectors &e, uint8_t hev_threshold,
+                      uint8_t interior_limit, uint8_t edge_limit) {
+  __m128i mask = NormalMask(e, interior_limit, edge_limit);
+  __m128i hev = HighVariance(e, hev_threshold);
+  __m128i ps2 = FlipSign(e.p2), ps1 = FlipSign(e.p1), ps0 = FlipSign(e.p0);
+  __m128i qs0 = FlipSign(e.q0), qs1 = FlipSign(e.q1), qs2 = FlipSign(e.q2);
+
+  __m128i w = FilterValue(_mm_subs_epi8(ps1, qs1), ps0, qs0);
+  w = _mm_and_si128(w, mask);
+
+  // High-variance pixels only get the common adjustment.
+  AdjustCenter(_mm_and_si128(w, hev), ps0, qs0);
+
+  // The others get the 27, 18 and 9 taps; w = 0 leaves a lane unchanged.
+  w = _mm_andnot_si128(hev, w);
+  __m128i a = Tap(w, 27);
+  qs0 = _mm_subs_epi8(qs0, a);
+  ps0 = _mm_adds_epi8(ps0, a);
+  a = Tap(w, 18);
+  qs1 = _mm_subs_epi8(qs1, a);
+  ps1 = _mm_adds_epi8(ps1, a);
+  a = Tap(w, 9);
+  qs2 = _mm_subs_epi8(qs2, a);
+  ps2 = _mm_adds_epi8(ps2, a);
+
+  e.p2 = FlipSign(ps2);
+  e.p1 = FlipSign(ps1);
+  e.p0 = FlipSign(ps0);
+  e.q0 = FlipSign(qs0);
+  e.q1 = FlipSign(qs1);
+  e.q2 = FlipSign(qs2);
 }
 
-void FillVertical(SubBlock &usb, SubBlock &dsb, size_t idx) {
-  usb.at(0).at(idx) = p3_;
-  usb.at(1).at(idx) = p2_;
-  usb.at(2).at(idx) = p1_;
-  usb.at(3).at(idx) = p0_;
-  dsb.at(0).at(idx) = q0_;
-  dsb.at(1).at(idx) = q1_;
-  dsb.at(2).at(idx) = q2_;
-  dsb.at(3).at(idx) = q3_;
+void SimpleFilter(EdgeVectors &e, uint8_t limit) {
+  __m128i mask = LessEqual(EdgeDiff(e), _mm_set1_epi8(char(limit)));
+  __m128i ps1 = FlipSign(e.p1), ps0 = FlipSign(e.p0);
+  __m128i qs0 = FlipSign(e.q0), qs1 = FlipSign(e.q1);
+
+  __m128i a = FilterValue(_mm_subs_epi8(ps1, qs1), ps0, qs0);
+  AdjustCenter(_mm_and_si128(a, mask), ps0, qs0);
+
+  e.p0 = FlipSign(ps0);
+  e.q0 = FlipSign(qs0);
 }
+#endif
 
 }  // namespace filter
 
@@ -149,17 +399,18 @@ void CalculateCoeffs(uint8_t loop_filter_level, uint8_t sharpness_level,
 }
 
 template <size_t C>
-void PlaneFilterNormal(const FrameHeader &header, size_t hblock, size_t vblock,
-                       bool is_key_frame,
+void PlaneFilterNormal(const FrameHeader &header, size_t hblock, size_t begin,
+                       size_t end, bool is_key_frame,
                        const std::vector<std::vector<uint8_t>> &lf,
                        const std::vector<std::vector<uint8_t>> &skip_lf,
                        Plane<C> &frame) {
   uint8_t sharpness_level = header.sharpness_level;
   if (header.loop_filter_level == 0) return;
 
-  for (size_t r = 0; r < vblock; r++) {
+  const size_t stride = frame.stride();
+  for (size_t r = begin; r < end; r++) {
     for (size_t c = 0; c < hblock; c++) {
-      MacroBlock<C> &mb = frame.at(r).at(c);
+      MacroBlock<C> mb = frame.at(r, c);
       uint8_t loop_filter_level = lf.at(r).at(c);
 
       if (loop_filter_level == 0) continue;
@@ -171,63 +422,43 @@ void PlaneFilterNormal(const FrameHeader &header, size_t hblock, size_t vblock,
                       edge_limit_sb);
 
       if (c > 0) {
-        MacroBlock<C> &lmb = frame.at(r).at(c - 1);
-        for (size_t i = 0; i < C; i++) {
-          SubBlock &rsb = mb.at(i).at(0);
-          SubBlock &lsb = lmb.at(i).at(C - 1);
-
-          for (size_t j = 0; j < 4; j++) {
-            filter::InitHorizontal(lsb, rsb, j);
-            filter::MacroBlockFilter(hev_threshold, interior_limit,
-                                     edge_limit_mb);
-            filter::FillHorizontal(lsb, rsb, j);
-          }
+        for (size_t i = 0; i < C * 4; i++) {
+          filter::EdgePixels e = filter::InitHorizontal(mb.Row(i));
+          filter::MacroBlockFilter(e, hev_threshold, interior_limit,
+                                   edge_limit_mb);
+          filter::FillHorizontal(e, mb.Row(i));
         }
       }
 
       if (!skip_lf.at(r).at(c)) {
         for (size_t i = 1; i < C; i++) {
-          for (size_t j = 0; j < C; j++) {
-            SubBlock &rsb = mb.at(j).at(i);
-            SubBlock &lsb = mb.at(j).at(i - 1);
-
-            for (size_t a = 0; a < 4; a++) {
-              filter::InitHorizontal(lsb, rsb, a);
-              filter::SubBlockFilter(hev_threshold, interior_limit,
-                                     edge_limit_sb);
-              filter::FillHorizontal(lsb, rsb, a);
-            }
+          for (size_t j = 0; j < C * 4; j++) {
+            filter::EdgePixels e =
+                filter::InitHorizontal(mb.Row(j) + (i << 2));
+            filter::SubBlockFilter(e, hev_threshold, interior_limit,
+                                   edge_limit_sb);
+            filter::FillHorizontal(e, mb.Row(j) + (i << 2));
           }
         }
       }
 
       if (r > 0) {
-        MacroBlock<C> &umb = frame.at(r - 1).at(c);
-        for (size_t i = 0; i < C; i++) {
-          SubBlock &dsb = mb.at(0).at(i);
-          SubBlock &usb = umb.at(C - 1).at(i);
-
-          for (size_t j = 0; j < 4; j++) {
-            filter::InitVertical(usb, dsb, j);
-            filter::MacroBlockFilter(hev_threshold, interior_limit,
-                                     edge_limit_mb);
-            filter::FillVertical(usb, dsb, j);
-          }
+        for (size_t i = 0; i < C * 4; i++) {
+          filter::EdgePixels e = filter::InitVertical(mb.Row(0) + i, stride);
+          filter::MacroBlockFilter(e, hev_threshold, interior_limit,
+                                   edge_limit_mb);
+          filter::FillVertical(e, mb.Row(0) + i, stride);
         }
       }
 
       if (!skip_lf.at(r).at(c)) {
         for (size_t i = 1; i < C; i++) {
-          for (size_t j = 0; j < C; j++) {
-            SubBlock &dsb = mb.at(i).at(j);
-            SubBlock &usb = mb.at(i - 1).at(j);
-
-            for (size_t a = 0; a < 4; a++) {
-              filter::InitVertical(usb, dsb, a);
-              filter::SubBlockFilter(hev_threshold, interior_limit,
-                                     edge_limit_sb);
-              filter::FillVertical(usb, dsb, a);
-            }
+          for (size_t j = 0; j < C * 4; j++) {
+            filter::EdgePixels e =
+                filter::InitVertical(mb.Row(i << 2) + j, stride);
+            filter::SubBlockFilter(e, hev_threshold, interior_limit,
+                                   edge_limit_sb);
+            filter::FillVertical(e, mb.Row(i << 2) + j, stride);
           }
         }
       }
@@ -235,17 +466,28 @@ void PlaneFilterNormal(const FrameHeader &header, size_t hblock, size_t vblock,
   }
 }
 
-void PlaneFilterSimple(const FrameHeader &header, size_t hblock, size_t vblock,
-                       bool is_key_frame,
+template void PlaneFilterNormal<4>(
+    const FrameHeader &header, size_t hblock, size_t begin, size_t end,
+    bool is_key_frame, const std::vector<std::vector<uint8_t>> &lf,
+    const std::vector<std::vector<uint8_t>> &skip_lf, Plane<4> &frame);
+
+template void PlaneFilterNormal<2>(
+    const FrameHeader &header, size_t hblock, size_t begin, size_t end,
+    bool is_key_frame, const std::vector<std::vector<uint8_t>> &lf,
+    const std::vector<std::vector<uint8_t>> &skip_lf, Plane<2> &frame);
+
+void PlaneFilterSimple(const FrameHeader &header, size_t hblock, size_t begin,
+                       size_t end, bool is_key_frame,
                        const std::vector<std::vector<uint8_t>> &lf,
                        const std::vector<std::vector<uint8_t>> &skip_lf,
                        Plane<4> &frame) {
   uint8_t sharpness_level = header.sharpness_level;
   if (header.loop_filter_level == 0) return;
 
-  for (size_t r = 0; r < vblock; r++) {
+  const size_t stride = frame.stride();
+  for (size_t r = begin; r < end; r++) {
     for (size_t c = 0; c < hblock; c++) {
-      MacroBlock<4> &mb = frame.at(r).at(c);
+      MacroBlock<4> mb = frame.at(r, c);
       uint8_t loop_filter_level = lf.at(r).at(c);
 
       if (loop_filter_level == 0) continue;
@@ -257,59 +499,39 @@ void PlaneFilterSimple(const FrameHeader &header, size_t hblock, size_t vblock,
                       edge_limit_sb);
 
       if (c > 0) {
-        MacroBlock<4> &lmb = frame.at(r).at(c - 1);
-        for (size_t i = 0; i < 4; i++) {
-          SubBlock &rsb = mb.at(i).at(0);
-          SubBlock &lsb = lmb.at(i).at(3);
-
-          for (size_t j = 0; j < 4; j++) {
-            filter::InitHorizontal(lsb, rsb, j);
-            filter::SimpleFilter(edge_limit_mb);
-            filter::FillHorizontal(lsb, rsb, j);
-          }
+        for (size_t i = 0; i < 16; i++) {
+          filter::EdgePixels e = filter::InitHorizontal(mb.Row(i));
+          filter::SimpleFilter(e, edge_limit_mb);
+          filter::FillHorizontal(e, mb.Row(i));
         }
       }
 
       if (!skip_lf.at(r).at(c)) {
         for (size_t i = 1; i < 4; i++) {
-          for (size_t j = 0; j < 4; j++) {
-            SubBlock &rsb = mb.at(j).at(i);
-            SubBlock &lsb = mb.at(j).at(i - 1);
-
-            for (size_t a = 0; a < 4; a++) {
-              filter::InitHorizontal(lsb, rsb, a);
-              filter::SimpleFilter(edge_limit_sb);
-              filter::FillHorizontal(lsb, rsb, a);
-            }
+          for (size_t j = 0; j < 16; j++) {
+            filter::EdgePixels e =
+                filter::InitHorizontal(mb.Row(j) + (i << 2));
+            filter::SimpleFilter(e, edge_limit_sb);
+            filter::FillHorizontal(e, mb.Row(j) + (i << 2));
           }
         }
       }
 
       if (r > 0) {
-        MacroBlock<4> &umb = frame.at(r - 1).at(c);
-        for (size_t i = 0; i < 4; i++) {
-          SubBlock &dsb = mb.at(0).at(i);
-          SubBlock &usb = umb.at(3).at(i);
-
-          for (size_t j = 0; j < 4; j++) {
-            filter::InitVertical(usb, dsb, j);
-            filter::SimpleFilter(edge_limit_mb);
-            filter::FillVertical(usb, dsb, j);
-          }
+        for (size_t i = 0; i < 16; i++) {
+          filter::EdgePixels e = filter::InitVertical(mb.Row(0) + i, stride);
+          filter::SimpleFilter(e, edge_limit_mb);
+          filter::FillVertical(e, mb.Row(0) + i, stride);
         }
       }
 
       if (!skip_lf.at(r).at(c)) {
         for (size_t i = 1; i < 4; i++) {
-          for (size_t j = 0; j < 4; j++) {
-            SubBlock &dsb = mb.at(i).at(j);
-            SubBlock &usb = mb.at(i - 1).at(j);
-
-            for (size_t a = 0; a < 4; a++) {
-              filter::InitVertical(usb, dsb, a);
-              filter::SimpleFilter(edge_limit_sb);
-              filter::FillVertical(usb, dsb, a);
-            }
+          for (size_t j = 0; j < 16; j++) {
+            filter::EdgePixels e =
+                filter::InitVertical(mb.Row(i << 2) + j, stride);
+            filter::SimpleFilter(e, edge_limit_sb);
+            filter::FillVertical(e, mb.Row(i << 2) + j, stride);
           }
         }
       }
@@ -317,6 +539,127 @@ void PlaneFilterSimple(const FrameHeader &header, size_t hblock, size_t vblock,
   }
 }
 
+#ifdef __SSE2__
+template <size_t C>
+void MacroBlockEdgesNormal(uint8_t *lo, uint8_t *hi, size_t stride, bool left,
+                           bool top, bool inner, uint8_t hev_threshold,
+                           uint8_t interior_limit, int16_t edge_limit_mb,
+                           int16_t edge_limit_sb) {
+  // The second half of a luma edge is the bottom (right) half of the same
+  // macroblock, while for chroma it is the V macroblock.
+  uint8_t *vertical_hi = C == 4 ? lo + 8 * stride : hi;
+  uint8_t *horizontal_hi = C == 4 ? lo + 8 : hi;
+  auto mb_limit = uint8_t(edge_limit_mb), sb_limit = uint8_t(edge_limit_sb);
+  filter::EdgeVectors e;
+
+  if (left) {
+    filter::LoadVerticalEdge(lo, vertical_hi, stride, e);
+    filter::MacroBlockFilter(e, hev_threshold, interior_limit, mb_limit);
+    filter::StoreVerticalEdge(lo, vertical_hi, stride, e);
+  }
+
+  if (inner) {
+    for (size_t i = 1; i < C; i++) {
+      filter::LoadVerticalEdge(lo + (i << 2), vertical_hi + (i << 2), stride,
+                               e);
+      filter::SubBlockFilter(e, hev_threshold, interior_limit, sb_limit);
+      filter::StoreVerticalEdge(lo + (i << 2), vertical_hi + (i << 2), stride,
+                                e);
+    }
+  }
+
+  if (top) {
+    filter::LoadHorizontalEdge(lo, horizontal_hi, stride, e);
+    filter::MacroBlockFilter(e, hev_threshold, interior_limit, mb_limit);
+    filter::StoreHorizontalEdge(lo, horizontal_hi, stride, e);
+  }
+
+  if (inner) {
+    for (size_t i = 1; i < C; i++) {
+      size_t offset = (i << 2) * stride;
+      filter::LoadHorizontalEdge(lo + offset, horizontal_hi + offset, stride,
+                                 e);
+      filter::SubBlockFilter(e, hev_threshold, interior_limit, sb_limit);
+      filter::StoreHorizontalEdge(lo + offset, horizontal_hi + offset, stride,
+                                  e);
+    }
+  }
+}
+
+void MacroBlockEdgesSimple(uint8_t *y, size_t stride, bool left, bool top,
+                           bool inner, int16_t edge_limit_mb,
+                           int16_t edge_limit_sb) {
+  auto mb_limit = uint8_t(edge_limit_mb), sb_limit = uint8_t(edge_limit_sb);
+  filter::EdgeVectors e;
+
+  if (left) {
+    filter::LoadVerticalEdge(y, y + 8 * stride, stride, e);
+    filter::SimpleFilter(e, mb_limit);
+    filter::StoreVerticalEdge(y, y + 8 * stride, stride, e);
+  }
+
+  if (inner) {
+    for (size_t i = 1; i < 4; i++) {
+      uint8_t *q0 = y + (i << 2);
+      filter::LoadVerticalEdge(q0, q0 + 8 * stride, stride, e);
+      filter::SimpleFilter(e, sb_limit);
+      filter::StoreVerticalEdge(q0, q0 + 8 * stride, stride, e);
+    }
+  }
+
+  if (top) {
+    filter::LoadHorizontalEdge(y, y + 8, stride, e);
+    filter::SimpleFilter(e, mb_limit);
+    filter::StoreHorizontalEdge(y, y + 8, stride, e);
+  }
+
+  if (inner) {
+    for (size_t i = 1; i < 4; i++) {
+      uint8_t *q0 = y + (i << 2) * stride;
+      filter::LoadHorizontalEdge(q0, q0 + 8, stride, e);
+      filter::SimpleFilter(e, sb_limit);
+      filter::StoreHorizontalEdge(q0, q0 + 8, stride, e);
+    }
+  }
+}
+
+void FilterRowsEdges(const FrameHeader &header, bool is_key_frame,
+                     const std::vector<std::vector<uint8_t>> &lf,
+                     const std::vector<std::vector<uint8_t>> &skip_lf,
+                     size_t begin, size_t end,
+                     const std::shared_ptr<Frame> &frame) {
+  if (header.loop_filter_level == 0) return;
+  const size_t y_stride = frame->Y.stride(), uv_stride = frame->U.stride();
+  for (size_t r = begin; r < end; r++) {
+    for (size_t c = 0; c < frame->hblock; c++) {
+      uint8_t loop_filter_level = lf.at(r).at(c);
+      if (loop_filter_level == 0) continue;
+
+      uint8_t interior_limit, hev_threshold;
+      int16_t edge_limit_mb, edge_limit_sb;
+      CalculateCoeffs(loop_filter_level, header.sharpness_level, is_key_frame,
+                      interior_limit, hev_threshold, edge_limit_mb,
+                      edge_limit_sb);
+
+      bool inner = !skip_lf.at(r).at(c);
+      uint8_t *y = frame->Y.at(r, c).Row(0);
+      if (header.filter_type) {
+        MacroBlockEdgesSimple(y, y_stride, c > 0, r > 0, inner, edge_limit_mb,
+                              edge_limit_sb);
+        continue;
+      }
+      MacroBlockEdgesNormal<4>(y, nullptr, y_stride, c > 0, r > 0, inner,
+                               hev_threshold, interior_limit, edge_limit_mb,
+                               edge_limit_sb);
+      MacroBlockEdgesNormal<2>(frame->U.at(r, c).Row(0),
+                               frame->V.at(r, c).Row(0), uv_stride, c > 0,
+                               r > 0, inner, hev_threshold, interior_limit,
+                               edge_limit_mb, edge_limit_sb);
+    }
+  }
+}
+#endif
+
 }  // namespace internal
 
 using namespace internal;
@@ -325,16 +668,29 @@ void FrameFilter(const FrameHeader &header, bool is_key_frame,
                  const std::vector<std::vector<uint8_t>> &lf,
                  const std::vector<std::vector<uint8_t>> &skip_lf,
                  const std::shared_ptr<Frame> &frame) {
-  size_t hblock = frame->hblock, vblock = frame->vblock;
+  FilterRows(header, is_key_frame, lf, skip_lf, 0, frame->vblock, frame);
+}
+
+void FilterRows(const FrameHeader &header, bool is_key_frame,
+                const std::vector<std::vector<uint8_t>> &lf,
+                const std::vector<std::vector<uint8_t>> &skip_lf, size_t begin,
+                size_t end, const std::shared_ptr<Frame> &frame) {
+  size_t hblock = frame->hblock;
+#ifdef __SSE2__
+  if (Dsp().simd_loop_filter) {
+    FilterRowsEdges(header, is_key_frame, lf, skip_lf, begin, end, frame);
+    return;
+  }
+#endif
   if (!header.filter_type) {
-    PlaneFilterNormal(header, hblock, vblock, is_key_frame, lf, skip_lf,
+    PlaneFilterNormal(header, hblock, begin, end, is_key_frame, lf, skip_lf,
                       frame->Y);
-    PlaneFilterNormal(header, hblock, vblock, is_key_frame, lf, skip_lf,
+    PlaneFilterNormal(header, hblock, begin, end, is_key_frame, lf, skip_lf,
                       frame->U);
-    PlaneFilterNormal(header, hblock, vblock, is_key_frame, lf, skip_lf,
+    PlaneFilterNormal(header, hblock, begin, end, is_key_frame, lf, skip_lf,
                       frame->V);
   } else {
-    PlaneFilterSimple(header, hblock, vblock, is_key_frame, lf, skip_lf,
+    PlaneFilterSimple(header, hblock, begin, end, is_key_frame, lf, skip_lf,
                       frame->Y);
   }
 }
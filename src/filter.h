@@ -4,6 +4,10 @@
 #include <memory>
 #include <vector>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "frame.h"
 #include "inter_predict.h"
 #include "intra_predict.h"
@@ -21,30 +25,72 @@ inline int16_t plus128(int16_t x) {
 
 namespace filter {
 
-static int16_t p3_, p2_, p1_, p0_;
-static int16_t q0_, q1_, q2_, q3_;
+// The pixels p3, ..., q3 on both sides of an edge, p0 and q0 being the ones
+// adjacent to it.
+struct EdgePixels {
+  int16_t p3, p2, p1, p0;
+  int16_t q0, q1, q2, q3;
+};
+
+inline bool IsFilterNormal(const EdgePixels &e, int16_t interior,
+                           int16_t edge);
+
+inline bool IsFilterSimple(const EdgePixels &e, int16_t edge);
+
+inline bool IsHighVariance(const EdgePixels &e, int16_t threshold);
+
+void Adjust(EdgePixels &e, bool use_outer_taps);
 
-inline bool IsFilterNormal(int16_t interior, int16_t edge);
+void SubBlockFilter(EdgePixels &e, int16_t hev_threshold,
+                    int16_t interior_limit, int16_t edge_limit);
 
-inline bool IsFilterSimple(int16_t edge);
+void MacroBlockFilter(EdgePixels &e, int16_t hev_threshold,
+                      int16_t interior_limit, int16_t edge_limit);
 
-inline bool IsHighVariance(int16_t threshold);
+void SimpleFilter(EdgePixels &e, int16_t limit);
 
-void Adjust(bool use_outer_taps);
+// Load (store) p3, ..., q3 from (to) the row containing q0 (q0 is the first
+// pixel to the right of the vertical edge).
+EdgePixels InitHorizontal(const uint8_t *q0);
+void FillHorizontal(const EdgePixels &e, uint8_t *q0);
 
-void SubBlockFilter(int16_t hev_threshold, int16_t interior_limit,
-                    int16_t edge_limit);
+// Load (store) p3, ..., q3 from (to) the column containing q0 (q0 is the first
+// pixel below the horizontal edge).
+EdgePixels InitVertical(const uint8_t *q0, size_t stride);
+void FillVertical(const EdgePixels &e, uint8_t *q0, size_t stride);
 
-void MacroBlockFilter(int16_t hev_threshold, int16_t interior_limit,
-                      int16_t edge_limit);
+#ifdef __SSE2__
+// The pixels p3, ..., q3 on both sides of a whole edge, one lane per pixel
+// along the edge.
+struct EdgeVectors {
+  __m128i p3, p2, p1, p0, q0, q1, q2, q3;
+};
 
-void SimpleFilter(int16_t limit);
+// Load (store) the 16 rows crossing a vertical edge: lanes 0-7 are the 8 rows
+// starting at lo and lanes 8-15 the 8 rows starting at hi, where lo and hi
+// point to q0 of their first row.
+void LoadVerticalEdge(const uint8_t *lo, const uint8_t *hi, size_t stride,
+                      EdgeVectors &e);
+void StoreVerticalEdge(uint8_t *lo, uint8_t *hi, size_t stride,
+                       const EdgeVectors &e);
 
-void InitHorizontal(const SubBlock &lsb, const SubBlock &rsb, size_t idx);
-void FillHorizontal(SubBlock &lsb, SubBlock &rsb, size_t idx);
+// Load (store) the 16 columns crossing a horizontal edge: lanes 0-7 are the 8
+// columns starting at lo and lanes 8-15 the 8 columns starting at hi, where lo
+// and hi point to q0 of their first column.
+void LoadHorizontalEdge(const uint8_t *lo, const uint8_t *hi, size_t stride,
+                        EdgeVectors &e);
+void StoreHorizontalEdge(uint8_t *lo, uint8_t *hi, size_t stride,
+                         const EdgeVectors &e);
 
-void InitVertical(const SubBlock &usb, const SubBlock &dsb, size_t idx);
-void FillVertical(SubBlock &usb, SubBlock &dsb, size_t idx);
+// Bit-exact 16-lane versions of the filters above.
+void SubBlockFilter(EdgeVectors &e, uint8_t hev_threshold,
+                    uint8_t interior_limit, uint8_t edge_limit);
+
+void MacroBlockFilter(EdgeVectors &e, uint8_t hev_threshold,
+                      uint8_t interior_limit, uint8_t edge_limit);
+
+void SimpleFilter(EdgeVectors &e, uint8_t limit);
+#endif
 
 }  // namespace filter
 
@@ -54,18 +100,42 @@ void CalculateCoeffs(uint8_t loop_filter_level, uint8_t sharpness_level,
                      int16_t &edge_limit_sb);
 
 template <size_t C>
-void PlaneFilterNormal(const FrameHeader &header, size_t hblock, size_t vblock,
-                       bool is_key_frame,
+void PlaneFilterNormal(const FrameHeader &header, size_t hblock, size_t begin,
+                       size_t end, bool is_key_frame,
                        const std::vector<std::vector<uint8_t>> &lf,
                        const std::vector<std::vector<uint8_t>> &skip_lf,
                        Plane<C> &frame);
 
-void PlaneFilterSimple(const FrameHeader &header, size_t hblock, size_t vblock,
-                       bool is_key_frame,
+void PlaneFilterSimple(const FrameHeader &header, size_t hblock, size_t begin,
+                       size_t end, bool is_key_frame,
                        const std::vector<std::vector<uint8_t>> &lf,
                        const std::vector<std::vector<uint8_t>> &skip_lf,
                        Plane<4> &frame);
 
+#ifdef __SSE2__
+// Filter the edges of a luma macroblock (C = 4, lo is its top-left pixel and hi
+// is unused) or of the two chroma macroblocks at the same position (C = 2, lo
+// and hi are the top-left pixels of U and V) in the order of PlaneFilterNormal,
+// one whole edge at a time.
+template <size_t C>
+void MacroBlockEdgesNormal(uint8_t *lo, uint8_t *hi, size_t stride, bool left,
+                           bool top, bool inner, uint8_t hev_threshold,
+                           uint8_t interior_limit, int16_t edge_limit_mb,
+                           int16_t edge_limit_sb);
+
+void MacroBlockEdgesSimple(uint8_t *y, size_t stride, bool left, bool top,
+                           bool inner, int16_t edge_limit_mb,
+                           int16_t edge_limit_sb);
+
+// FilterRows with the functions above, used unless the kernels in use are the
+// scalar ones (see DspKernels::simd_loop_filter).
+void FilterRowsEdges(const FrameHeader &header, bool is_key_frame,
+                     const std::vector<std::vector<uint8_t>> &lf,
+                     const std::vector<std::vector<uint8_t>> &skip_lf,
+                     size_t begin, size_t end,
+                     const std::shared_ptr<Frame> &frame);
+#endif
+
 }  // namespace internal
 
 void FrameFilter(const FrameHeader &header, bool is_key_frame,
@@ -73,6 +143,14 @@ void FrameFilter(const FrameHeader &header, bool is_key_frame,
                  const std::vector<std::vector<uint8_t>> &skip_lf,
                  const std::shared_ptr<Frame> &frame);
 
+// Filter the macroblock rows [begin, end). Filtering row r also modifies the
+// bottom pixels of row r - 1, so rows have to be filtered in order; the result
+// is the same as filtering the whole frame at once.
+void FilterRows(const FrameHeader &header, bool is_key_frame,
+                const std::vector<std::vector<uint8_t>> &lf,
+                const std::vector<std::vector<uint8_t>> &skip_lf, size_t begin,
+                size_t end, const std::shared_ptr<Frame> &frame);
+
 }  // namespace vp8
 
 #endif  // FILTER_H_
@@ -3,7 +3,11 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -12,6 +16,10 @@
 
 namespace vp8 {
 
+// The pixel buffer of each plane, and therefore each of its rows (the stride is
+// rounded up to a multiple of it), is aligned to this many bytes.
+constexpr size_t kPlaneAlign = 32;
+
 struct MotionVector {
   MotionVector() : dr(0), dc(0) {}
   explicit MotionVector(int16_t dr_, int16_t dc_) : dr(dr_), dc(dc_) {}
@@ -34,188 +42,166 @@ struct MotionVector {
   int16_t dc;
 };
 
+// The representative motion vector of a luma macroblock together with the
+// motion vectors of its 16 subblocks (in raster-scan order).
+struct MotionInfo {
+  MotionVector mv;
+  std::array<MotionVector, 16> sub_mvs;
+};
+
+// A 4x4 window into the pixels of a plane. It does not own the pixels; copying
+// a SubBlock only copies the view.
 class SubBlock {
  public:
-  SubBlock() = default;
-
-  inline std::array<int16_t, 4>& at(size_t i) { return pixels_.at(i); }
-
-  inline std::array<int16_t, 4> at(size_t i) const { return pixels_.at(i); }
-
-  void FillWith(int16_t p) {
-    for (size_t i = 0; i < 4; ++i)
-      std::fill(pixels_.at(i).begin(), pixels_.at(i).end(), p);
-  }
+  explicit SubBlock(uint8_t* ptr, size_t stride) : ptr_(ptr), stride_(stride) {}
 
-  void FillRow(const std::array<int16_t, 4>& row) {
-    for (size_t i = 0; i < 4; ++i)
-      std::copy(row.begin(), row.end(), pixels_.at(i).begin());
-  }
-
-  template <class Iterator>
-  void FillRow(Iterator iter) {
-    for (size_t i = 0; i < 4; ++i) {
-      auto it1 = pixels_.at(i).begin();
-      auto it2 = iter;
-      for (size_t j = 0; j < 4; ++j) *it1++ = *it2++;
-    }
-  }
+  // Returns a pointer to the i-th row of the subblock.
+  inline uint8_t* at(size_t i) const { return ptr_ + i * stride_; }
 
-  void FillCol(const std::array<int16_t, 4>& col) {
-    for (size_t i = 0; i < 4; ++i)
-      std::fill(pixels_.at(i).begin(), pixels_.at(i).end(), col.at(i));
-  }
-
-  template <class Iterator>
-  void FillCol(Iterator iter) {
-    for (size_t i = 0; i < 4; ++i)
-      std::fill(pixels_.at(i).begin(), pixels_.at(i).end(), *iter++);
-  }
+  inline uint8_t GetPixel(size_t r, size_t c) const { return at(r)[c]; }
 
-  std::array<int16_t, 4> GetRow(size_t i) const { return pixels_.at(i); }
+  inline void SetPixel(size_t r, size_t c, uint8_t v) const { at(r)[c] = v; }
 
-  std::array<int16_t, 4> GetCol(size_t i) const {
-    return std::array<int16_t, 4>{pixels_.at(0).at(i), pixels_.at(1).at(i),
-                                  pixels_.at(2).at(i), pixels_.at(3).at(i)};
+  void FillWith(uint8_t p) const {
+    for (size_t i = 0; i < 4; ++i) std::memset(at(i), p, 4);
   }
 
-  MotionVector GetMotionVector() const { return mv_; }
-
-  void SetMotionVector(int16_t dr, int16_t dc) { mv_ = MotionVector(dr, dc); }
-
-  void SetMotionVector(const MotionVector& v) { mv_ = v; }
+  size_t stride() const { return stride_; }
 
  private:
-  std::array<std::array<int16_t, 4>, 4> pixels_{};
-  MotionVector mv_;
+  uint8_t* ptr_;
+  size_t stride_;
 };
 
+// A (C * 4)x(C * 4) window into the pixels of a plane. C = 4 for luma and C = 2
+// for chroma.
 template <size_t C>
 class MacroBlock {
  public:
-  MacroBlock() : offset_(C == 4 ? 2 : 1), mask_((1 << offset_) - 1) {}
+  explicit MacroBlock(uint8_t* ptr, size_t stride)
+      : ptr_(ptr), stride_(stride) {}
 
-  inline std::array<SubBlock, C>& at(size_t i) { return subs_.at(i); }
+  // Returns a pointer to the i-th row of the macroblock.
+  inline uint8_t* Row(size_t i) const { return ptr_ + i * stride_; }
 
-  inline std::array<SubBlock, C> at(size_t i) const { return subs_.at(i); }
-
-  void FillWith(int16_t p) {
-    for (size_t i = 0; i < C; ++i) {
-      for (size_t j = 0; j < C; ++j) subs_.at(i).at(j).FillWith(p);
-    }
+  // Returns the subblock located in (i, j).
+  inline SubBlock at(size_t i, size_t j) const {
+    return SubBlock(Row(i << 2) + (j << 2), stride_);
   }
 
-  void FillRow(const std::array<int16_t, C * 4>& row) {
-    for (size_t i = 0; i < C; ++i) {
-      for (size_t j = 0; j < C; ++j)
-        subs_.at(i).at(j).FillRow(row.begin() + (j << 2));
-    }
-  }
+  inline uint8_t GetPixel(size_t r, size_t c) const { return Row(r)[c]; }
 
-  void FillCol(const std::array<int16_t, C * 4>& col) {
-    for (size_t i = 0; i < C; ++i) {
-      for (size_t j = 0; j < C; ++j)
-        subs_.at(i).at(j).FillCol(col.begin() + (i << 2));
-    }
-  }
-
-  std::array<int16_t, C * 4> GetRow(size_t i) const {
-    std::array<int16_t, C * 4> res{};
-    for (size_t c = 0; c < C; ++c) {
-      std::array<int16_t, 4> row = subs_.at(i >> 2).at(c).GetRow(i & 3);
-      std::copy(row.begin(), row.end(), res.begin() + (c << 2));
-    }
-    return res;
-  }
+  inline void SetPixel(size_t r, size_t c, uint8_t v) const { Row(r)[c] = v; }
 
-  std::array<int16_t, C * 4> GetCol(size_t i) const {
-    std::array<int16_t, C * 4> res{};
-    for (size_t c = 0; c < C; ++c) {
-      std::array<int16_t, 4> col = subs_.at(c).at(i >> 2).GetCol(i & 3);
-      std::copy(col.begin(), col.end(), res.begin() + (c << 2));
-    }
-    return res;
+  void FillWith(uint8_t p) const {
+    for (size_t i = 0; i < C * 4; ++i) std::memset(Row(i), p, C * 4);
   }
 
-  __attribute__((always_inline))
-  inline int16_t GetPixel(size_t r, size_t c) const {
-    return subs_.at(r >> 2).at(c >> 2).at(r & 3).at(c & 3);
+  // Fill each row of the macroblock with row[0..C * 4).
+  void FillRow(const uint8_t* row) const {
+    for (size_t i = 0; i < C * 4; ++i) std::memcpy(Row(i), row, C * 4);
   }
 
-  inline void SetPixel(size_t r, size_t c, int16_t v) {
-    subs_.at(r >> 2).at(c >> 2).at(r & 3).at(c & 3) = v;
+  // Fill the i-th row of the macroblock with col[i * step].
+  void FillCol(const uint8_t* col, size_t step) const {
+    for (size_t i = 0; i < C * 4; ++i) std::memset(Row(i), col[i * step], C * 4);
   }
 
-  inline void IncrementPixel(size_t r, size_t c, int16_t v) {
-    subs_.at(r >> 2).at(c >> 2).at(r & 3).at(c & 3) += v;
-  }
+  size_t stride() const { return stride_; }
 
-  MotionVector GetMotionVector() const { return mv_; }
+ private:
+  uint8_t* ptr_;
+  size_t stride_;
+};
 
-  void SetMotionVector(int16_t dr, int16_t dc) { mv_ = MotionVector(dr, dc); }
+// A plane of (vblock * C * 4)x(hblock * C * 4) pixels stored row by row in one
+// aligned buffer. The plane is surrounded by a border of kBorder pixels on each
+// side so that motion-compensated fetches may read outside of the picture
+// without clamping every coordinate; ExtendBorder() fills it by replicating the
+// outermost pixels.
+template <size_t C>
+class Plane {
+ public:
+  // 64 pixels for luma and 32 for chroma. Motion vectors may point arbitrarily
+  // far outside of the plane, so inter prediction clamps the position of a
+  // block until its sixtap window (2 pixels before it and 3 after, plus the 3
+  // the kernels may read past it) lies within the border, where it only sees
+  // replicated pixels and the prediction is unchanged. That takes 12 pixels;
+  // 32 leaves room for whole 8x8 chroma (and 16x16 luma) blocks near the edges
+  // to be predicted at once. Keeping it a multiple of kPlaneAlign preserves
+  // the alignment of each row.
+  static constexpr size_t kBorder = C * 16;
 
-  void SetMotionVector(const MotionVector& v) { mv_ = v; }
+  Plane() : vblock_(0), hblock_(0), stride_(0), origin_(nullptr) {}
 
-  MotionVector GetSubBlockMV(size_t r, size_t c) const {
-    return subs_.at(r).at(c).GetMotionVector();
+  explicit Plane(size_t vblock, size_t hblock)
+      : vblock_(vblock),
+        hblock_(hblock),
+        stride_((hblock * C * 4 + 2 * kBorder + kPlaneAlign - 1) &
+                ~(kPlaneAlign - 1)) {
+    size_t bytes = (vsize() + 2 * kBorder) * stride_;
+    data_.reset(static_cast<uint8_t*>(std::aligned_alloc(kPlaneAlign, bytes)));
+    check(data_ != nullptr, "[Error] Plane::Plane: Out of memory.");
+    std::memset(data_.get(), 0, bytes);
+    origin_ = data_.get() + kBorder * stride_ + kBorder;
   }
 
-  MotionVector GetSubBlockMV(size_t id) const {
-    return subs_.at(id >> offset_).at(id & mask_).GetMotionVector();
-  }
+  inline uint8_t* Row(size_t r) { return origin_ + r * stride_; }
 
-  // The motion vectors are the same for all subblocks.
-  void SetSubBlockMVs(const MotionVector& v) {
-    for (size_t i = 0; i < C; ++i) {
-      for (size_t j = 0; j < C; ++j) subs_.at(i).at(j).SetMotionVector(v);
-    }
+  inline const uint8_t* Row(size_t r) const { return origin_ + r * stride_; }
+
+  // Returns a pointer to the pixel (r, c), which may lie within the border.
+  inline const uint8_t* Offset(ptrdiff_t r, ptrdiff_t c) const {
+    return origin_ + r * ptrdiff_t(stride_) + c;
   }
 
- private:
-  MotionVector mv_;
-  size_t offset_, mask_;
-  std::array<std::array<SubBlock, C>, C> subs_;
-};
+  inline uint8_t GetPixel(size_t r, size_t c) const { return Row(r)[c]; }
 
-template <size_t C>
-class Plane {
- public:
-  Plane() : offset_(C == 4 ? 4 : 3), mask_((1 << offset_) - 1) {}
+  inline void SetPixel(size_t r, size_t c, uint8_t v) { Row(r)[c] = v; }
 
-  explicit Plane(size_t h, size_t w)
-      : offset_(C == 4 ? 4 : 3), mask_((1 << offset_) - 1) {
-    blocks_.resize(h, std::vector<MacroBlock<C>>(w));
+  // Returns the macroblock located in (r, c).
+  inline MacroBlock<C> at(size_t r, size_t c) {
+    return MacroBlock<C>(Row(r * C * 4) + c * C * 4, stride_);
   }
 
-  inline int16_t GetPixel(size_t r, size_t c) const {
-    return blocks_.at(r >> offset_)
-        .at(c >> offset_)
-        .GetPixel(r & mask_, c & mask_);
+  // Replicate the pixels on the edges of the plane into the border.
+  void ExtendBorder() {
+    if (vblock_ == 0 || hblock_ == 0) return;
+    size_t h = vsize(), w = hsize();
+    for (size_t r = 0; r < h; ++r) {
+      uint8_t* row = Row(r);
+      std::memset(row - kBorder, row[0], kBorder);
+      std::memset(row + w, row[w - 1], kBorder);
+    }
+    const uint8_t* top = Row(0) - kBorder;
+    const uint8_t* bottom = Row(h - 1) - kBorder;
+    for (size_t r = 1; r <= kBorder; ++r) {
+      std::memcpy(Row(0) - r * stride_ - kBorder, top, w + 2 * kBorder);
+      std::memcpy(Row(h - 1) + r * stride_ - kBorder, bottom, w + 2 * kBorder);
+    }
   }
 
-  std::vector<MacroBlock<C>>& at(size_t i) { return blocks_.at(i); }
+  size_t vblock() const { return vblock_; }
+  size_t hblock() const { return hblock_; }
 
-  const std::vector<MacroBlock<C>>& at(size_t i) const { return blocks_.at(i); }
+  size_t vsize() const { return vblock_ * C * 4; }
+  size_t hsize() const { return hblock_ * C * 4; }
 
-  size_t vblock() const { return blocks_.size(); }
-  size_t hblock() const { return blocks_.at(0).size(); }
-
-  size_t vsize() const { return blocks_.size() * C * 4; }
-  size_t hsize() const { return blocks_.at(0).size() * C * 4; }
+  size_t stride() const { return stride_; }
 
  private:
-  size_t offset_, mask_;
-  std::vector<std::vector<MacroBlock<C>>> blocks_;
+  struct AlignedFree {
+    void operator()(uint8_t* ptr) const { std::free(ptr); }
+  };
+
+  size_t vblock_, hblock_, stride_;
+  std::unique_ptr<uint8_t[], AlignedFree> data_;
+  uint8_t* origin_;
 };
 
 struct Frame {
   Frame() : vsize(0), hsize(0), vblock(0), hblock(0) {}
-  explicit Frame(size_t h, size_t w)
-      : vsize(h), hsize(w), vblock((h + 15) >> 4), hblock((w + 15) >> 4) {
-    Y = Plane<4>(vblock, hblock);
-    U = Plane<2>(vblock, hblock);
-    V = Plane<2>(vblock, hblock);
-  }
+  explicit Frame(size_t h, size_t w) { resize(h, w); }
 
   void resize(size_t h, size_t w) {
     vsize = h;
@@ -225,11 +211,27 @@ struct Frame {
     Y = Plane<4>(vblock, hblock);
     U = Plane<2>(vblock, hblock);
     V = Plane<2>(vblock, hblock);
+    motion.assign(vblock * hblock, MotionInfo());
+  }
+
+  // Fill the borders of all three planes. Must be called once the frame is
+  // fully reconstructed and filtered, before it is used as a reference.
+  void ExtendBorders() {
+    Y.ExtendBorder();
+    U.ExtendBorder();
+    V.ExtendBorder();
+  }
+
+  MotionInfo& MotionAt(size_t r, size_t c) { return motion[r * hblock + c]; }
+
+  const MotionInfo& MotionAt(size_t r, size_t c) const {
+    return motion[r * hblock + c];
   }
 
   size_t vsize, hsize, vblock, hblock;
   Plane<4> Y;
   Plane<2> U, V;
+  std::vector<MotionInfo> motion;
 };
 
 }  // namespace vp8
@@ -0,0 +1,23 @@
+#include "frame_pool.h"
+
+#include <algorithm>
+
+namespace vp8 {
+
+std::shared_ptr<Frame> FramePool::Acquire(size_t height, size_t width) {
+  if (height != vsize_ || width != hsize_) {
+    // Buffers of the old size which are still referenced are released by
+    // their holders; the pool simply forgets about them.
+    frames_.clear();
+    vsize_ = height;
+    hsize_ = width;
+  }
+  for (const std::shared_ptr<Frame> &frame : frames_) {
+    if (frame.use_count() == 1) return frame;
+  }
+  frames_.push_back(std::make_shared<Frame>(height, width));
+  high_water_mark_ = std::max(high_water_mark_, frames_.size());
+  return frames_.back();
+}
+
+}  // namespace vp8
@@ -0,0 +1,37 @@
+#ifndef FRAME_POOL_H_
+#define FRAME_POOL_H_
+
+#include <memory>
+#include <vector>
+
+#include "frame.h"
+
+namespace vp8 {
+
+// A pool of frame buffers shared between the frame being decoded and the
+// reference frames. A buffer is handed out again once the pool holds the only
+// reference to it, i.e. it is no longer LAST/GOLDEN/ALTREF (nor the current
+// frame). Buffers are reallocated only when the frame size changes.
+class FramePool {
+ public:
+  FramePool() : vsize_(0), hsize_(0), high_water_mark_(0) {}
+
+  // Returns a frame of the given size whose content is unspecified. Every
+  // pixel (and motion vector) is expected to be overwritten by the decoder.
+  std::shared_ptr<Frame> Acquire(size_t height, size_t width);
+
+  // The number of buffers currently owned by the pool.
+  size_t size() const { return frames_.size(); }
+
+  // The maximum number of buffers ever allocated at the same time.
+  size_t HighWaterMark() const { return high_water_mark_; }
+
+ private:
+  size_t vsize_, hsize_;
+  size_t high_water_mark_;
+  std::vector<std::shared_ptr<Frame>> frames_;
+};
+
+}  // namespace vp8
+
+#endif  // FRAME_POOL_H_
@@ -3,9 +3,17 @@
 #include <utility>
 
 namespace vp8 {
+
+Interpolation::Interpolation(const FrameTag &tag)
+    : Interpolation(tag.version != 0) {}
+
+Interpolation::Interpolation(bool bilinear)
+    : filter(bilinear ? &kBilinearFilter : &kBicubicFilter),
+      kernel(bilinear ? internal::Dsp().bilinear : internal::Dsp().sixtap) {}
+
 namespace internal {
 
-InterMBHeader SearchMVs(size_t r, size_t c, const Plane<4> &mb,
+InterMBHeader SearchMVs(size_t r, size_t c, const Frame &frame,
                         const std::array<bool, kNumRefFrames> &ref_frame_bias,
                         uint8_t ref_frame,
                         const std::array<Context, 3> &context,
@@ -20,7 +28,7 @@ InterMBHeader SearchMVs(size_t r, size_t c, const Plane<4> &mb,
   enum { UPPER_CTX = 0, LEFT_CTX = 1, UPPER_LEFT_CTX = 2 };
 
   if (r > 0 && context.at(UPPER_CTX).is_inter_mb) {
-    MotionVector v = mb.at(r - 1).at(c).GetMotionVector();
+    MotionVector v = frame.MotionAt(r - 1, c).mv;
     if (v != kZero) {
       v = Invert(v, context.at(UPPER_CTX).ref_frame(), ref_frame,
                  ref_frame_bias);
@@ -30,7 +38,7 @@ InterMBHeader SearchMVs(size_t r, size_t c, const Plane<4> &mb,
   }
 
   if (c > 0 && context.at(LEFT_CTX).is_inter_mb) {
-    MotionVector v = mb.at(r).at(c - 1).GetMotionVector();
+    MotionVector v = frame.MotionAt(r, c - 1).mv;
     if (v != kZero) {
       v = Invert(v, context.at(LEFT_CTX).ref_frame(), ref_frame,
                  ref_frame_bias);
@@ -42,7 +50,7 @@ InterMBHeader SearchMVs(size_t r, size_t c, const Plane<4> &mb,
   }
 
   if (r > 0 && c > 0 && context.at(UPPER_LEFT_CTX).is_inter_mb) {
-    MotionVector v = mb.at(r - 1).at(c - 1).GetMotionVector();
+    MotionVector v = frame.MotionAt(r - 1, c - 1).mv;
     if (v != kZero) {
       v = Invert(v, context.at(UPPER_LEFT_CTX).ref_frame(), ref_frame,
                  ref_frame_bias);
@@ -113,14 +121,14 @@ uint8_t SubBlockContext(const MotionVector &left, const MotionVector &above) {
   return kSubBlockContext.at(bool(left)).at(bool(above)).at(left == above);
 }
 
-void ConfigureChromaMVs(const MacroBlock<4> &luma, size_t vblock, size_t hblock,
-                        bool trim, MacroBlock<2> &U, MacroBlock<2> &V) {
+void ConfigureChromaMVs(const MotionInfo &luma, size_t vblock, size_t hblock,
+                        bool trim, std::array<MotionVector, 4> &chroma_mvs) {
   for (size_t r = 0; r < 2; ++r) {
     for (size_t c = 0; c < 2; ++c) {
-      MotionVector ulv = luma.at(r << 1).at(c << 1).GetMotionVector(),
-                   urv = luma.at(r << 1).at(c << 1 | 1).GetMotionVector(),
-                   dlv = luma.at(r << 1 | 1).at(c << 1).GetMotionVector(),
-                   drv = luma.at(r << 1 | 1).at(c << 1 | 1).GetMotionVector();
+      MotionVector ulv = luma.sub_mvs.at(r << 3 | c << 1),
+                   urv = luma.sub_mvs.at(r << 3 | c << 1 | 1),
+                   dlv = luma.sub_mvs.at(r << 3 | 4 | c << 1),
+                   drv = luma.sub_mvs.at(r << 3 | 4 | c << 1 | 1);
 
       int16_t sr = int16_t(ulv.dr + urv.dr + dlv.dr + drv.dr);
       int16_t sc = int16_t(ulv.dc + urv.dc + dlv.dc + drv.dc);
@@ -137,8 +145,7 @@ void ConfigureChromaMVs(const MacroBlock<4> &luma, size_t vblock, size_t hblock,
 
       MotionVector mv = MotionVector(dr, dc);
       ClampMV(left, right, top, bottom, mv);
-      U.at(r).at(c).SetMotionVector(dr, dc);
-      V.at(r).at(c).SetMotionVector(dr, dc);
+      chroma_mvs.at(r << 1 | c) = MotionVector(dr, dc);
     }
   }
 }
@@ -146,24 +153,26 @@ void ConfigureChromaMVs(const MacroBlock<4> &luma, size_t vblock, size_t hblock,
 void ConfigureSubBlockMVs(const InterMBHeader &hd, size_t r, size_t c,
                           MotionVector best,
                           const std::unique_ptr<BitstreamParser> &ps,
-                          Plane<4> &mb) {
-  auto LeftMotionVector = [&mb, r, c](size_t idx) {
+                          Frame &frame) {
+  MotionInfo &info = frame.MotionAt(r, c);
+
+  auto LeftMotionVector = [&frame, &info, r, c](size_t idx) {
     if ((idx & 3) == 0) {
       if (c == 0) return kZero;
-      return mb.at(r).at(c - 1).GetSubBlockMV(idx + 3);
+      return frame.MotionAt(r, c - 1).sub_mvs.at(idx + 3);
     }
-    return mb.at(r).at(c).GetSubBlockMV(idx - 1);
+    return info.sub_mvs.at(idx - 1);
   };
 
-  auto AboveMotionVector = [&mb, r, c](size_t idx) {
+  auto AboveMotionVector = [&frame, &info, r, c](size_t idx) {
     if (idx < 4) {
       if (r == 0) return kZero;
-      return mb.at(r - 1).at(c).GetSubBlockMV(idx + 12);
+      return frame.MotionAt(r - 1, c).sub_mvs.at(idx + 12);
     }
-    return mb.at(r).at(c).GetSubBlockMV(idx - 4);
+    return info.sub_mvs.at(idx - 4);
   };
 
-  static std::array<MotionVector, kNumSubBlockMVMode> mvs{};
+  std::array<MotionVector, kNumSubBlockMVMode> mvs{};
   uint64_t mask = kHead.at(hd.mv_split_mode);
 
   for (size_t i = 0; i < kNumPartition.at(hd.mv_split_mode); ++i) {
@@ -177,8 +186,7 @@ void ConfigureSubBlockMVs(const InterMBHeader &hd, size_t r, size_t c,
         (mode == NEW_4x4 ? ps->ReadSubBlockMV() + best : mvs.at(mode));
     for (int8_t ptr = int8_t(head); ptr != -1;
          ptr = kNext.at(hd.mv_split_mode).at(size_t(ptr))) {
-      size_t ir = size_t(ptr) >> 2, ic = size_t(ptr) & 3;
-      mb.at(r).at(c).at(ir).at(ic).SetMotionVector(mv);
+      info.sub_mvs.at(size_t(ptr)) = mv;
     }
   }
 }
@@ -188,14 +196,15 @@ Context ConfigureMVs(size_t r, size_t c, bool trim,
                      uint8_t ref_frame, const std::array<Context, 3> &context,
                      std::vector<std::vector<uint8_t>> &skip_lf,
                      const std::unique_ptr<BitstreamParser> &ps,
-                     const std::shared_ptr<Frame> &frame) {
+                     const std::shared_ptr<Frame> &frame,
+                     std::array<MotionVector, 4> &chroma_mvs) {
   int16_t top = ((-int16_t(r) * 16) * 8);
   int16_t bottom = ((int16_t(frame->vblock) - 1 - int16_t(r)) * 16) * 8;
   int16_t left = ((-int16_t(c) * 16) * 8);
   int16_t right = ((int16_t(frame->hblock) - 1 - int16_t(c)) * 16) * 8;
 
   MotionVector best, nearest, near, mv;
-  InterMBHeader hd = SearchMVs(r, c, frame->Y, ref_frame_bias, ref_frame,
+  InterMBHeader hd = SearchMVs(r, c, *frame, ref_frame_bias, ref_frame,
                                context, ps, best, nearest, near);
 
   ClampMV2(top, bottom, left, right, best);
@@ -205,156 +214,175 @@ Context ConfigureMVs(size_t r, size_t c, bool trim,
   Context ctx(hd.mv_mode, ref_frame);
   if (hd.mv_mode == MV_SPLIT) skip_lf.at(r).at(c) = 0;
 
+  MotionInfo &info = frame->MotionAt(r, c);
   switch (hd.mv_mode) {
     case MV_NEAREST:
-      frame->Y.at(r).at(c).SetSubBlockMVs(nearest);
-      frame->Y.at(r).at(c).SetMotionVector(nearest);
+      info.sub_mvs.fill(nearest);
+      info.mv = nearest;
       break;
 
     case MV_NEAR:
-      frame->Y.at(r).at(c).SetSubBlockMVs(near);
-      frame->Y.at(r).at(c).SetMotionVector(near);
+      info.sub_mvs.fill(near);
+      info.mv = near;
       break;
 
     case MV_ZERO:
-      frame->Y.at(r).at(c).SetSubBlockMVs(kZero);
-      frame->Y.at(r).at(c).SetMotionVector(kZero);
+      info.sub_mvs.fill(kZero);
+      info.mv = kZero;
       break;
 
     case MV_NEW:
       mv = hd.mv_new + best;
-      frame->Y.at(r).at(c).SetSubBlockMVs(mv);
-      frame->Y.at(r).at(c).SetMotionVector(mv);
+      info.sub_mvs.fill(mv);
+      info.mv = mv;
       break;
 
     case MV_SPLIT:
-      ConfigureSubBlockMVs(hd, r, c, best, ps, frame->Y);
-      mv = frame->Y.at(r).at(c).GetSubBlockMV(15);
-      frame->Y.at(r).at(c).SetMotionVector(mv);
+      ConfigureSubBlockMVs(hd, r, c, best, ps, *frame);
+      info.mv = info.sub_mvs.at(15);
       break;
 
     default:
-      ensure(false, "[Error] Unknown macroblock motion vector mode.");
+      check(false, "[Error] Unknown macroblock motion vector mode.");
       break;
   }
 
-  ConfigureChromaMVs(frame->Y.at(r).at(c), frame->vblock, frame->hblock, trim,
-                     frame->U.at(r).at(c), frame->V.at(r).at(c));
+  ConfigureChromaMVs(info, frame->vblock, frame->hblock, trim, chroma_mvs);
   return ctx;
 }
 
 template <size_t C>
-std::array<std::array<int16_t, 4>, 9> HorizontalSixtap(
-    const Plane<C> &refer, int32_t r, int32_t c,
-    const std::array<int16_t, 6> &filter) {
-  std::array<std::array<int16_t, 4>, 9> res;
-
-  auto GetPixel = [&refer](int32_t row, int32_t col) -> int16_t {
-    row = std::clamp(row, 0, int32_t(refer.vsize()) - 1);
-    col = std::clamp(col, 0, int32_t(refer.hsize()) - 1);
-    return refer.GetPixel(size_t(row), size_t(col));
-  };
-
-  std::array<int32_t, 9> cache;
+void Sixtap(const Plane<C> &refer, int32_t r, int32_t c, uint8_t mr, uint8_t mc,
+            const std::array<std::array<int16_t, 6>, 8> &filter,
+            const SubBlock &sub) {
+  Dsp().sixtap(refer.Offset(r, c), refer.stride(), 4, 4, filter.at(mc).data(),
+               filter.at(mr).data(), sub.at(0), sub.stride());
+}
 
-  for (int32_t i = 0; i < 9; ++i) {
-    for (size_t j = 0; j < 9; ++j)
-      cache.at(j) = GetPixel(r + i, c - 2 + int32_t(j));
+namespace {
 
-    for (size_t j = 0; j < 4; ++j) {
-      int32_t sum =
-          cache.at(j + 0) * filter.at(0) + cache.at(j + 1) * filter.at(1) +
-          cache.at(j + 2) * filter.at(2) + cache.at(j + 3) * filter.at(3) +
-          cache.at(j + 4) * filter.at(4) + cache.at(j + 5) * filter.at(5);
-      res.at(size_t(i)).at(j) = Clamp255(int16_t((sum + 64) >> 7));
+// Predict the size x size block (size being 4, 8 or 16) at (r, c) of the plane
+// from refer, displaced by mv, into dst.
+template <size_t C>
+void PredictBlock(const Plane<C> &refer, const Interpolation &interp, int32_t r,
+                  int32_t c, size_t size, MotionVector mv, uint8_t *dst,
+                  size_t stride) {
+  constexpr int32_t kMinOffset = 2 - int32_t(Plane<C>::kBorder);
+  constexpr int32_t kMaxOffset = int32_t(Plane<C>::kBorder) - 7;
+  uint8_t mr = mv.dr & 7, mc = mv.dc & 7;
+  int32_t tr = r + (mv.dr >> 3);
+  int32_t tc = c + (mv.dc >> 3);
+  int32_t last = int32_t(size) - 4;
+  // The subblocks of a larger block are predicted one by one (and clamped as
+  // below) unless none of them would be clamped, leaving room for the 3
+  // pixels the kernels may read past the window.
+  if (size > 4 &&
+      (tr < kMinOffset || tr + last > int32_t(refer.vsize()) + kMaxOffset ||
+       tc < kMinOffset ||
+       tc + last > int32_t(refer.hsize()) + kMaxOffset - 3)) {
+    for (size_t i = 0; i < size; i += 4) {
+      for (size_t j = 0; j < size; j += 4)
+        PredictBlock(refer, interp, r + int32_t(i), c + int32_t(j), 4, mv,
+                     dst + i * stride + j, stride);
     }
+    return;
   }
-  return res;
-}
-
-void VerticalSixtap(const std::array<std::array<int16_t, 4>, 9> &refer,
-                    const std::array<int16_t, 6> &filter, SubBlock &sub) {
-  for (size_t i = 0; i < 4; ++i) {
-    for (size_t j = 0; j < 4; ++j) {
-      int32_t sum = int32_t(refer.at(i + 0).at(j)) * filter.at(0) +
-                    int32_t(refer.at(i + 1).at(j)) * filter.at(1) +
-                    int32_t(refer.at(i + 2).at(j)) * filter.at(2) +
-                    int32_t(refer.at(i + 3).at(j)) * filter.at(3) +
-                    int32_t(refer.at(i + 4).at(j)) * filter.at(4) +
-                    int32_t(refer.at(i + 5).at(j)) * filter.at(5);
-      sub.at(i).at(j) = Clamp255(int16_t((sum + 64) >> 7));
-    }
+  // Motion vectors may point arbitrarily far outside of the plane. Once the
+  // sixtap window (rows/columns [t - 2, t + 6]) of a subblock lies entirely
+  // within the border it only sees replicated edge pixels, so pulling it back
+  // to the border does not change the prediction.
+  tr = std::clamp(tr, kMinOffset, int32_t(refer.vsize()) + kMaxOffset);
+  tc = std::clamp(tc, kMinOffset, int32_t(refer.hsize()) + kMaxOffset);
+  if (mr | mc) {
+    interp.kernel(refer.Offset(tr, tc), refer.stride(), size, size,
+                  interp.filter->at(mc).data(), interp.filter->at(mr).data(),
+                  dst, stride);
+  } else {
+    // Whole-pixel motion vectors copy the block.
+    for (size_t x = 0; x < size; ++x)
+      std::memcpy(dst + x * stride, refer.Offset(tr + int32_t(x), tc), size);
   }
 }
 
-template <size_t C>
-void Sixtap(const Plane<C> &refer, int32_t r, int32_t c, uint8_t mr, uint8_t mc,
-            const std::array<std::array<int16_t, 6>, 8> &filter,
-            SubBlock &sub) {
-  std::array<std::array<int16_t, 4>, 9> tmp =
-      HorizontalSixtap(refer, r - 2, c, filter.at(mc));
-  VerticalSixtap(tmp, filter.at(mr), sub);
-}
+}  // namespace
 
 template <size_t C>
-void InterpBlock(const Plane<C> &refer,
-                 const std::array<std::array<int16_t, 6>, 8> &filter, size_t r,
-                 size_t c, MacroBlock<C> &mb) {
-  size_t offset = C / 2 + 2;
-  for (size_t i = 0; i < C; ++i) {
-    for (size_t j = 0; j < C; ++j) {
-      MotionVector mv = mb.at(i).at(j).GetMotionVector();
-      if (mv == kZero) {
-        for (size_t x = 0; x < 4; ++x) {
-          for (size_t y = 0; y < 4; ++y)
-            mb.at(i).at(j).at(x).at(y) = refer.GetPixel(
-                (r << offset) | (i << 2) | x, (c << offset) | (j << 2) | y);
-        }
+void InterpBlock(const Plane<C> &refer, const Interpolation &interp, size_t r,
+                 size_t c, const MotionVector *mvs, const MacroBlock<C> &mb) {
+  auto top = int32_t(r * C * 4), left = int32_t(c * C * 4);
+  // The whole macroblock at once when its subblocks share their motion vector
+  // (in every mode but MV_SPLIT), else each 8x8 quadrant whose subblocks do,
+  // else subblock by subblock.
+  if (std::all_of(mvs + 1, mvs + C * C,
+                  [mvs](const MotionVector &mv) { return mv == mvs[0]; })) {
+    PredictBlock(refer, interp, top, left, C * 4, mvs[0], mb.Row(0),
+                 mb.stride());
+    return;
+  }
+  for (size_t i = 0; i < C; i += 2) {
+    for (size_t j = 0; j < C; j += 2) {
+      const MotionVector *quadrant = mvs + i * C + j;
+      if (quadrant[1] == quadrant[0] && quadrant[C] == quadrant[0] &&
+          quadrant[C + 1] == quadrant[0]) {
+        PredictBlock(refer, interp, top + int32_t(i << 2),
+                     left + int32_t(j << 2), 8, quadrant[0],
+                     mb.Row(i << 2) + (j << 2), mb.stride());
         continue;
       }
-      uint8_t mr = mv.dr & 7, mc = mv.dc & 7;
-      int32_t tr = int32_t(r << offset | (i << 2)) + (mv.dr >> 3);
-      int32_t tc = int32_t(c << offset | (j << 2)) + (mv.dc >> 3);
-      if (mr | mc) {
-        Sixtap(refer, tr, tc, mr, mc, filter, mb.at(i).at(j));
-      } else {
-        auto GetPixel = [&refer](int32_t row, int32_t col) -> int16_t {
-          row = std::clamp(row, 0, int32_t(refer.vsize()) - 1);
-          col = std::clamp(col, 0, int32_t(refer.hsize()) - 1);
-          return refer.GetPixel(size_t(row), size_t(col));
-        };
-        for (uint8_t x = 0; x < 4; ++x) {
-          for (uint8_t y = 0; y < 4; ++y)
-            mb.at(i).at(j).at(x).at(y) = GetPixel(tr + x, tc + y);
-        }
+      for (size_t k = i; k < i + 2; ++k) {
+        for (size_t l = j; l < j + 2; ++l)
+          PredictBlock(refer, interp, top + int32_t(k << 2),
+                       left + int32_t(l << 2), 4, mvs[k * C + l],
+                       mb.Row(k << 2) + (l << 2), mb.stride());
       }
     }
   }
 }
 
+template void Sixtap<4>(const Plane<4> &refer, int32_t r, int32_t c,
+                        uint8_t mr, uint8_t mc,
+                        const std::array<std::array<int16_t, 6>, 8> &filter,
+                        const SubBlock &sub);
+
+template void Sixtap<2>(const Plane<2> &refer, int32_t r, int32_t c,
+                        uint8_t mr, uint8_t mc,
+                        const std::array<std::array<int16_t, 6>, 8> &filter,
+                        const SubBlock &sub);
+
+template void InterpBlock<4>(const Plane<4> &refer, const Interpolation &interp,
+                             size_t r, size_t c, const MotionVector *mvs,
+                             const MacroBlock<4> &mb);
+
+template void InterpBlock<2>(const Plane<2> &refer, const Interpolation &interp,
+                             size_t r, size_t c, const MotionVector *mvs,
+                             const MacroBlock<2> &mb);
+
 }  // namespace internal
 
-Context InterPredict(
-    const FrameTag &tag, size_t r, size_t c,
+Context ReadInterModes(const FrameTag &tag, size_t r, size_t c,
+                       const std::array<bool, kNumRefFrames> &ref_frame_bias,
+                       uint8_t ref_frame, const std::array<Context, 3> &context,
+                       std::vector<std::vector<uint8_t>> &skip_lf,
+                       const std::unique_ptr<BitstreamParser> &ps,
+                       const std::shared_ptr<Frame> &frame,
+                       std::array<MotionVector, 4> &chroma_mvs) {
+  return internal::ConfigureMVs(r, c, tag.version == 3, ref_frame_bias,
+                                ref_frame, context, skip_lf, ps, frame,
+                                chroma_mvs);
+}
+
+void InterPredict(
+    const Interpolation &interp, size_t r, size_t c,
     const std::array<std::shared_ptr<Frame>, kNumRefFrames> &refs,
-    const std::array<bool, kNumRefFrames> &ref_frame_bias, uint8_t ref_frame,
-    const std::array<Context, 3> &context,
-    std::vector<std::vector<uint8_t>> &skip_lf,
-    const std::unique_ptr<BitstreamParser> &ps,
+    uint8_t ref_frame, const std::array<MotionVector, 4> &chroma_mvs,
     const std::shared_ptr<Frame> &frame) {
-  Context ctx = internal::ConfigureMVs(r, c, tag.version == 3, ref_frame_bias,
-                                       ref_frame, context, skip_lf, ps, frame);
-
-  const std::array<std::array<int16_t, 6>, 8> &subpixel_filters =
-      tag.version == 0 ? kBicubicFilter : kBilinearFilter;
-
-  internal::InterpBlock(refs.at(ref_frame)->Y, subpixel_filters, r, c,
-                        frame->Y.at(r).at(c));
-  internal::InterpBlock(refs.at(ref_frame)->U, subpixel_filters, r, c,
-                        frame->U.at(r).at(c));
-  internal::InterpBlock(refs.at(ref_frame)->V, subpixel_filters, r, c,
-                        frame->V.at(r).at(c));
-  return ctx;
+  internal::InterpBlock(refs.at(ref_frame)->Y, interp, r, c,
+                        frame->MotionAt(r, c).sub_mvs.data(),
+                        frame->Y.at(r, c));
+  internal::InterpBlock(refs.at(ref_frame)->U, interp, r, c, chroma_mvs.data(),
+                        frame->U.at(r, c));
+  internal::InterpBlock(refs.at(ref_frame)->V, interp, r, c, chroma_mvs.data(),
+                        frame->V.at(r, c));
 }
 
 }  // namespace vp8
@@ -9,6 +9,7 @@
 
 #include "bitstream_parser.h"
 #include "context.h"
+#include "dsp.h"
 #include "frame.h"
 #include "residual.h"
 #include "utils.h"
@@ -35,6 +36,19 @@ constexpr std::array<std::array<int16_t, 6>, 8> kBilinearFilter = {
      {0, 0, 32, 96, 0, 0},
      {0, 0, 16, 112, 0, 0}}};
 
+// The subpixel interpolation of the frames of a stream: the bicubic filters
+// with the sixtap kernel for version 0, the bilinear filters with their own
+// kernel otherwise (see FrameTag::version). Picked once per frame.
+struct Interpolation {
+  explicit Interpolation(const FrameTag &tag);
+  // The bilinear filters if bilinear, the bicubic ones otherwise.
+  explicit Interpolation(bool bilinear);
+
+  const std::array<std::array<int16_t, 6>, 8> *filter;
+  // DspKernels::sixtap or DspKernels::bilinear.
+  decltype(internal::DspKernels::sixtap) kernel;
+};
+
 namespace internal {
 
 static const MotionVector kZero = MotionVector(0, 0);
@@ -56,7 +70,7 @@ constexpr std::array<std::array<int8_t, 16>, 4> kNext = {
 
 // Search for motion vectors in the left, above and upper-left macroblocks and
 // return the best, nearest and near motion vectors.
-InterMBHeader SearchMVs(size_t r, size_t c, const Plane<4> &mb,
+InterMBHeader SearchMVs(size_t r, size_t c, const Frame &frame,
                         const std::array<bool, kNumRefFrames> &ref_frame_bias,
                         uint8_t ref_frame,
                         const std::array<Context, 3> &context,
@@ -82,58 +96,61 @@ uint8_t SubBlockContext(const MotionVector &left, const MotionVector &above);
 
 // The motion vectors of chroma subblocks are the average value of the motion
 // vectors occupying the same position in the luma subblocks.
-void ConfigureChromaMVs(const MacroBlock<4> &luma, size_t vblock, size_t hblock,
-                        bool trim, MacroBlock<2> &U, MacroBlock<2> &V);
+void ConfigureChromaMVs(const MotionInfo &luma, size_t vblock, size_t hblock,
+                        bool trim, std::array<MotionVector, 4> &chroma_mvs);
 
 // In case of mode MV_SPLIT, set the motion vectors of each subblock
 // independently.
 void ConfigureSubBlockMVs(const InterMBHeader &hd, size_t r, size_t c,
                           MotionVector best,
                           const std::unique_ptr<BitstreamParser> &ps,
-                          Plane<4> &mb);
+                          Frame &frame);
 
 // For each (luma or chroma) macroblocks, configure their motion vectors (if
-// needed).
+// needed). The luma motion vectors are stored in the frame while the chroma
+// ones are returned through chroma_mvs.
 Context ConfigureMVs(size_t r, size_t c, bool trim,
-                          const std::array<bool, 4> &ref_frame_bias,
-                          uint8_t ref_frame,
-                          const std::array<Context, 3> &context,
-                          std::vector<std::vector<uint8_t>> &skip_lf,
-                          const std::unique_ptr<BitstreamParser> &ps,
-                          const std::shared_ptr<Frame> &frame);
-
-// Horizontal pixel interpolation, this should return a 9x4 temporary matrix for
-// the vertical pixel interpolation later.
-template <size_t C>
-std::array<std::array<int16_t, 4>, 9> HorizontalSixtap(
-    const Plane<C> &refer, int32_t r, int32_t c,
-    const std::array<int16_t, 6> &filter);
-
-// Vertical pixel interpolation.
-void VerticalSixtap(const std::array<std::array<int16_t, 4>, 9> &refer,
-                    const std::array<int16_t, 6> &filter, SubBlock &sub);
-
-// Sixtap pixel interpolation. First do the horizontal interpolation, then
-// vertical.
+                     const std::array<bool, 4> &ref_frame_bias,
+                     uint8_t ref_frame, const std::array<Context, 3> &context,
+                     std::vector<std::vector<uint8_t>> &skip_lf,
+                     const std::unique_ptr<BitstreamParser> &ps,
+                     const std::shared_ptr<Frame> &frame,
+                     std::array<MotionVector, 4> &chroma_mvs);
+
+// Sixtap pixel interpolation of the subblock at (r, c) of the reference plane.
+// First do the horizontal interpolation, then vertical (see
+// DspKernels::sixtap).
 template <size_t C>
 void Sixtap(const Plane<C> &refer, int32_t r, int32_t c, uint8_t mr, uint8_t mc,
-            const std::array<std::array<int16_t, 6>, 8> &filter, SubBlock &sub);
+            const std::array<std::array<int16_t, 6>, 8> &filter,
+            const SubBlock &sub);
 
 // For each of the macroblock in the current plane, predict the value of it.
+// mvs holds the motion vectors of the C * C subblocks in raster-scan order. The
+// subblocks sharing a motion vector are interpolated together, as a whole
+// macroblock or as 8x8 quadrants.
 template <size_t C>
-void InterpBlock(const Plane<C> &refer,
-                 const std::array<std::array<int16_t, 6>, 8> &filter, size_t r,
-                 size_t c, MacroBlock<C> &mb);
+void InterpBlock(const Plane<C> &refer, const Interpolation &interp, size_t r,
+                 size_t c, const MotionVector *mvs, const MacroBlock<C> &mb);
 
 }  // namespace internal
 
-Context InterPredict(
-    const FrameTag &tag, size_t r, size_t c,
+// Read the motion vectors of inter macroblock (r, c). The luma motion vectors
+// are stored in the frame while the chroma ones are returned through
+// chroma_mvs.
+Context ReadInterModes(const FrameTag &tag, size_t r, size_t c,
+                       const std::array<bool, kNumRefFrames> &ref_frame_bias,
+                       uint8_t ref_frame, const std::array<Context, 3> &context,
+                       std::vector<std::vector<uint8_t>> &skip_lf,
+                       const std::unique_ptr<BitstreamParser> &ps,
+                       const std::shared_ptr<Frame> &frame,
+                       std::array<MotionVector, 4> &chroma_mvs);
+
+// Predict macroblock (r, c) from the reference frame ref_frame.
+void InterPredict(
+    const Interpolation &interp, size_t r, size_t c,
     const std::array<std::shared_ptr<Frame>, kNumRefFrames> &refs,
-    const std::array<bool, kNumRefFrames> &ref_frame_bias, uint8_t ref_frame,
-    const std::array<Context, 3> &context,
-    std::vector<std::vector<uint8_t>> &skip_lf,
-    const std::unique_ptr<BitstreamParser> &ps,
+    uint8_t ref_frame, const std::array<MotionVector, 4> &chroma_mvs,
     const std::shared_ptr<Frame> &frame);
 
 }  // namespace vp8
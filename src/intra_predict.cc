@@ -1,430 +1,245 @@
 #include "intra_predict.h"
 
+#include <cstring>
+
+#include "dsp.h"
+
 namespace vp8 {
 namespace internal {
+namespace {
+
+static_assert(INTRA_DC == int(DC_PRED) && INTRA_V == int(V_PRED) &&
+                  INTRA_H == int(H_PRED) && INTRA_TM == int(TM_PRED),
+              "The first IntraKernels must be the MacroBlockModes.");
+
+// The kernel predicting macroblock (r, c) with mode: DC prediction depends on
+// the edges the macroblock has.
+IntraKernel KernelOf(size_t r, size_t c, MacroBlockMode mode) {
+  if (mode != DC_PRED) return IntraKernel(mode);
+  if (r == 0) return c == 0 ? INTRA_DC_NO_EDGE : INTRA_DC_NO_TOP;
+  return c == 0 ? INTRA_DC_NO_LEFT : INTRA_DC;
+}
+
+template <size_t C>
+void PredictMB(size_t r, size_t c, MacroBlockMode mode, Plane<C> &mb) {
+  const auto &kernels = C == 4 ? Dsp().pred16 : Dsp().pred8;
+  kernels[KernelOf(r, c, mode)](mb.at(r, c).Row(0), mb.stride());
+}
+
+template <size_t C>
+void InitEdges(Plane<C> &plane) {
+  // From the above-left pixel to the above-right ones of the last macroblock.
+  std::memset(plane.Row(0) - plane.stride() - 1, kUpperPixel,
+              plane.hsize() + 5);
+  for (size_t r = 0; r < plane.vsize(); ++r) plane.Row(r)[-1] = kLeftPixel;
+}
+
+}  // namespace
+
+void InitIntraEdges(Frame &frame) {
+  InitEdges(frame.Y);
+  InitEdges(frame.U);
+  InitEdges(frame.V);
+}
 
 void VPredChroma(size_t r, size_t c, Plane<2> &mb) {
-  if (r == 0)
-    mb.at(r).at(c).FillWith(kUpperPixel);
-  else
-    mb.at(r).at(c).FillRow(mb.at(r - 1).at(c).GetRow(7));
+  PredictMB(r, c, V_PRED, mb);
 }
 
 void HPredChroma(size_t r, size_t c, Plane<2> &mb) {
-  if (c == 0)
-    mb.at(r).at(c).FillWith(kLeftPixel);
-  else
-    mb.at(r).at(c).FillCol(mb.at(r).at(c - 1).GetCol(7));
+  PredictMB(r, c, H_PRED, mb);
 }
 
 void DCPredChroma(size_t r, size_t c, Plane<2> &mb) {
-  if (r == 0 && c == 0) {
-    mb.at(r).at(c).FillWith(kUpperLeftPixel);
-    return;
-  }
-
-  int32_t sum = 0, shf = 2;
-  if (r > 0) {
-    for (size_t i = 0; i < 8; ++i) sum += mb.at(r - 1).at(c).GetPixel(7, i);
-    shf++;
-  }
-  if (c > 0) {
-    for (size_t i = 0; i < 8; ++i) sum += mb.at(r).at(c - 1).GetPixel(i, 7);
-    shf++;
-  }
-
-  int16_t avg = int16_t((sum + (1 << (shf - 1))) >> shf);
-  mb.at(r).at(c).FillWith(avg);
+  PredictMB(r, c, DC_PRED, mb);
 }
 
 void TMPredChroma(size_t r, size_t c, Plane<2> &mb) {
-  int16_t p =
-      (r == 0 ? kUpperPixel
-              : c == 0 ? kLeftPixel : mb.at(r - 1).at(c - 1).GetPixel(7, 7));
-  for (size_t i = 0; i < 8; ++i) {
-    for (size_t j = 0; j < 8; ++j) {
-      int16_t x = (c == 0 ? kLeftPixel : mb.at(r).at(c - 1).GetPixel(i, 7));
-      int16_t y = (r == 0 ? kUpperPixel : mb.at(r - 1).at(c).GetPixel(7, j));
-      mb.at(r).at(c).SetPixel(i, j, Clamp255(int16_t(x + y - p)));
-    }
-  }
+  PredictMB(r, c, TM_PRED, mb);
 }
 
 void VPredLuma(size_t r, size_t c, Plane<4> &mb) {
-  if (r == 0)
-    mb.at(r).at(c).FillWith(kUpperPixel);
-  else
-    mb.at(r).at(c).FillRow(mb.at(r - 1).at(c).GetRow(15));
+  PredictMB(r, c, V_PRED, mb);
 }
 
 void HPredLuma(size_t r, size_t c, Plane<4> &mb) {
-  if (c == 0)
-    mb.at(r).at(c).FillWith(kLeftPixel);
-  else
-    mb.at(r).at(c).FillCol(mb.at(r).at(c - 1).GetCol(15));
+  PredictMB(r, c, H_PRED, mb);
 }
 
 void DCPredLuma(size_t r, size_t c, Plane<4> &mb) {
-  if (r == 0 && c == 0) {
-    mb.at(r).at(c).FillWith(128);
-    return;
-  }
-
-  int32_t sum = 0, shf = 3;
-  if (r > 0) {
-    for (size_t i = 0; i < 16; ++i) sum += mb.at(r - 1).at(c).GetPixel(15, i);
-    shf++;
-  }
-  if (c > 0) {
-    for (size_t i = 0; i < 16; ++i) sum += mb.at(r).at(c - 1).GetPixel(i, 15);
-    shf++;
-  }
-
-  int16_t avg = int16_t((sum + (1 << (shf - 1))) >> shf);
-  mb.at(r).at(c).FillWith(avg);
+  PredictMB(r, c, DC_PRED, mb);
 }
 
 void TMPredLuma(size_t r, size_t c, Plane<4> &mb) {
-  int16_t p =
-      (r == 0 ? kUpperPixel
-              : c == 0 ? kLeftPixel : mb.at(r - 1).at(c - 1).GetPixel(15, 15));
-  for (size_t i = 0; i < 16; ++i) {
-    for (size_t j = 0; j < 16; ++j) {
-      int16_t x = (c == 0 ? kLeftPixel : mb.at(r).at(c - 1).GetPixel(i, 15));
-      int16_t y = (r == 0 ? kUpperPixel : mb.at(r - 1).at(c).GetPixel(15, j));
-      mb.at(r).at(c).SetPixel(i, j, Clamp255(int16_t(x + y - p)));
+  PredictMB(r, c, TM_PRED, mb);
+}
+
+void BPredEdges(size_t r, size_t c, size_t i, size_t j, Plane<4> &mb,
+                std::array<uint8_t, 8> &above, std::array<uint8_t, 4> &left,
+                uint8_t &p) {
+  bool has_above = i > 0 || r > 0;
+  bool has_left = j > 0 || c > 0;
+  size_t y = (r << 4) | (i << 2), x = (c << 4) | (j << 2);
+
+  const uint8_t *row_above = has_above ? mb.Row(y - 1) + x : nullptr;
+  if (has_above)
+    std::copy(row_above, row_above + 4, above.begin());
+  else
+    std::fill(above.begin(), above.begin() + 4, kUpperPixel);
+
+  if (j == 3) {
+    // The pixels above and to the right of the rightmost subblocks are always
+    // taken from the macroblock row above.
+    if (r == 0) {
+      std::fill(above.begin() + 4, above.end(), kUpperPixel);
+    } else if (c + 1 == mb.hblock()) {
+      std::fill(above.begin() + 4, above.end(),
+                mb.GetPixel((r << 4) - 1, (c << 4) | 15));
+    } else {
+      const uint8_t *row_right = mb.Row((r << 4) - 1) + ((c + 1) << 4);
+      std::copy(row_right, row_right + 4, above.begin() + 4);
     }
+  } else {
+    if (has_above)
+      std::copy(row_above + 4, row_above + 8, above.begin() + 4);
+    else
+      std::fill(above.begin() + 4, above.end(), kUpperPixel);
   }
-}
 
-std::array<Context, 2> BPredLuma(size_t r, size_t c, bool is_key_frame,
-                                 const ResidualValue &rv,
-                                 const std::array<Context, 2> &context,
-                                 const std::unique_ptr<BitstreamParser> &ps,
-                                 Plane<4> &mb) {
-  Context row = context.at(1).ctx;
-  Context col = context.at(0).ctx;
+  if (has_left) {
+    for (size_t k = 0; k < 4; ++k) left.at(k) = mb.GetPixel(y + k, x - 1);
+  } else {
+    std::fill(left.begin(), left.end(), kLeftPixel);
+  }
 
-  uint32_t zero = rv.zero;
-  std::array<Context, 2> ctx{};
+  p = !has_above ? kUpperPixel
+                 : !has_left ? kLeftPixel : mb.GetPixel(y - 1, x - 1);
+}
+
+void BPredLuma(size_t r, size_t c, const MacroBlockResidual &res,
+               const std::array<SubBlockMode, 16> &sub_modes, Plane<4> &mb) {
+  const auto &kernels = Dsp().pred4;
+  MacroBlock<4> cur = mb.at(r, c);
+  size_t stride = mb.stride();
+
+  // The pixels above and to the right of the rightmost subblocks are always
+  // taken from the macroblock row above, whose last pixel stands for the ones
+  // past the right edge of the plane.
+  const uint8_t *above_mb = cur.Row(0) - stride;
+  uint8_t above_right[4];
+  if (r > 0 && c + 1 == mb.hblock())
+    std::memset(above_right, above_mb[15], 4);
+  else
+    std::memcpy(above_right, above_mb + 16, 4);
 
   for (size_t i = 0; i < 4; ++i) {
     for (size_t j = 0; j < 4; ++j) {
-      std::array<int16_t, 8> above{};
-      std::array<int16_t, 4> left{};
-      std::array<int16_t, 4> row_above{};
-      std::array<int16_t, 4> row_right{};
-
-      if (i > 0) {
-        row_above = mb.at(r).at(c).at(i - 1).at(j).GetRow(3);
-      } else {
-        if (r == 0)
-          std::fill(row_above.begin(), row_above.end(), kUpperPixel);
-        else
-          row_above = mb.at(r - 1).at(c).at(3).at(j).GetRow(3);
-      }
-
+      SubBlock sub = cur.at(i, j);
+      const uint8_t *above = sub.at(0) - stride;
+      // The above-left pixel, the ones above and the above-right ones.
+      uint8_t edge[9];
       if (j == 3) {
-        if (r == 0) {
-          std::fill(row_right.begin(), row_right.end(), kUpperPixel);
-        } else if (c + 1 == mb.at(r).size()) {
-          int16_t x = mb.at(r - 1).at(c).at(3).at(3).at(3).at(3);
-          std::fill(row_right.begin(), row_right.end(), x);
-        } else {
-          row_right = mb.at(r - 1).at(c + 1).at(3).at(0).GetRow(3);
-        }
-      } else {
-        if (i > 0) {
-          row_right = mb.at(r).at(c).at(i - 1).at(j + 1).GetRow(3);
-        } else {
-          if (r == 0)
-            std::fill(row_right.begin(), row_right.end(), kUpperPixel);
-          else
-            row_right = mb.at(r - 1).at(c).at(3).at(j + 1).GetRow(3);
-        }
+        std::memcpy(edge, above - 1, 5);
+        std::memcpy(edge + 5, above_right, 4);
+        above = edge + 1;
       }
-
-      std::copy(row_above.begin(), row_above.end(), above.begin());
-      std::copy(row_right.begin(), row_right.end(), above.begin() + 4);
-
-      if (j > 0) {
-        left = mb.at(r).at(c).at(i).at(j - 1).GetCol(3);
-      } else {
-        if (c == 0)
-          std::fill(left.begin(), left.end(), kLeftPixel);
-        else
-          left = mb.at(r).at(c - 1).at(i).at(3).GetCol(3);
-      }
-
-      int16_t p = 0;
-      if (i > 0 && j > 0)
-        p = mb.at(r).at(c).at(i - 1).at(j - 1).at(3).at(3);
-      else if (i > 0)
-        p = c == 0 ? kLeftPixel
-                   : mb.at(r).at(c - 1).at(i - 1).at(3).at(3).at(3);
-      else if (j > 0)
-        p = r == 0 ? kUpperPixel
-                   : mb.at(r - 1).at(c).at(3).at(j - 1).at(3).at(3);
-      else
-        p = r == 0 && c == 0
-                ? kUpperPixel
-                : r == 0
-                      ? kUpperPixel
-                      : c == 0 ? kLeftPixel
-                               : mb.at(r - 1).at(c - 1).at(3).at(3).at(3).at(3);
-
-      SubBlockMode mode =
-          is_key_frame ? ps->ReadSubBlockBModeKF(col.mode(j), row.mode(i))
-                       : ps->ReadSubBlockBModeNonKF();
-
-      if (i == 3) ctx.at(0).append(j, mode);
-      if (j == 3) ctx.at(1).append(i, mode);
-      col.append(j, mode);
-      row.append(i, mode);
-      BPredSubBlock(above, left, p, mode, mb.at(r).at(c).at(i).at(j));
-      ApplySBResidual(rv.y.at(i << 2 | j), zero & 1,
-                      mb.at(r).at(c).at(i).at(j));
-      zero >>= 1;
+      kernels[sub_modes.at(i << 2 | j)](above, sub.at(0), stride);
+      ApplySBResidual(res.rd, 1 + (i << 2 | j), res.ydqf, sub);
     }
   }
-  return ctx;
 }
 
-void BPredSubBlock(const std::array<int16_t, 8> &above,
-                   const std::array<int16_t, 4> &left, int16_t p,
-                   SubBlockMode mode, SubBlock &sub) {
-  const std::array<int16_t, 9> edge = {
-      left.at(3),  left.at(2),  left.at(1),  left.at(0),  p,
-      above.at(0), above.at(1), above.at(2), above.at(3),
-  };
-  switch (mode) {
-    case B_VE_PRED: {
-      for (size_t i = 0; i < 4; ++i) {
-        int16_t x = i == 0 ? p : above.at(i - 1);
-        int16_t y = above.at(i);
-        int16_t z = above.at(i + 1);
-        int16_t avg = (x + y + y + z + 2) >> 2;
-        sub.at(0).at(i) = sub.at(1).at(i) = sub.at(2).at(i) = sub.at(3).at(i) =
-            avg;
-      }
-      break;
-    }
-
-    case B_HE_PRED: {
-      for (size_t i = 0; i < 4; ++i) {
-        int16_t x = i == 0 ? p : left.at(i - 1);
-        int16_t y = left.at(i);
-        int16_t z = i == 3 ? left.at(3) : left.at(i + 1);
-        int16_t avg = (x + y + y + z + 2) >> 2;
-        sub.at(i).at(0) = sub.at(i).at(1) = sub.at(i).at(2) = sub.at(i).at(3) =
-            avg;
-      }
-      break;
-    }
-
-    case B_DC_PRED: {
-      int16_t v = 4;
-      for (size_t i = 0; i < 4; ++i) v += above.at(i) + left.at(i);
-      v >>= 3;
-      sub.FillWith(v);
-      break;
-    }
-
-    case B_TM_PRED: {
-      for (size_t i = 0; i < 4; ++i) {
-        for (size_t j = 0; j < 4; ++j)
-          sub.at(i).at(j) = Clamp255(int16_t(left.at(i) + above.at(j) - p));
-      }
-      break;
-    }
-
-    case B_LD_PRED: {
-      for (size_t d = 0; d < 7; ++d) {
-        int16_t x = above.at(d);
-        int16_t y = above.at(d + 1);
-        int16_t z = d + 2 < 8 ? above.at(d + 2) : above.at(7);
-        int16_t avg = (x + y + y + z + 2) >> 2;
-        for (size_t i = 0; i < 4 && int(d) - int(i) >= 0; ++i) {
-          if (int(d) - int(i) < 4) sub.at(i).at(d - i) = avg;
-        }
-      }
-      break;
-    }
-
-    case B_RD_PRED: {
-      sub.at(3).at(0) =
-          (edge.at(0) + edge.at(1) + edge.at(1) + edge.at(2) + 2) >> 2;
-      sub.at(3).at(1) = sub.at(2).at(0) =
-          (edge.at(1) + edge.at(2) + edge.at(2) + edge.at(3) + 2) >> 2;
-      sub.at(3).at(2) = sub.at(2).at(1) = sub.at(1).at(0) =
-          (edge.at(2) + edge.at(3) + edge.at(3) + edge.at(4) + 2) >> 2;
-      sub.at(3).at(3) = sub.at(2).at(2) = sub.at(1).at(1) = sub.at(0).at(0) =
-          (edge.at(3) + edge.at(4) + edge.at(4) + edge.at(5) + 2) >> 2;
-      sub.at(2).at(3) = sub.at(1).at(2) = sub.at(0).at(1) =
-          (edge.at(4) + edge.at(5) + edge.at(5) + edge.at(6) + 2) >> 2;
-      sub.at(1).at(3) = sub.at(0).at(2) =
-          (edge.at(5) + edge.at(6) + edge.at(6) + edge.at(7) + 2) >> 2;
-      sub.at(0).at(3) =
-          (edge.at(6) + edge.at(7) + edge.at(7) + edge.at(8) + 2) >> 2;
-      break;
-    }
-
-    case B_VR_PRED: {
-      sub.at(3).at(0) =
-          (edge.at(1) + edge.at(2) + edge.at(2) + edge.at(3) + 2) >> 2;
-      sub.at(2).at(0) =
-          (edge.at(2) + edge.at(3) + edge.at(3) + edge.at(4) + 2) >> 2;
-      sub.at(3).at(1) = sub.at(1).at(0) =
-          (edge.at(3) + edge.at(4) + edge.at(4) + edge.at(5) + 2) >> 2;
-      sub.at(2).at(1) = sub.at(0).at(0) = (edge.at(4) + edge.at(5) + 1) >> 1;
-      sub.at(3).at(2) = sub.at(1).at(1) =
-          (edge.at(4) + edge.at(5) + edge.at(5) + edge.at(6) + 2) >> 2;
-      sub.at(2).at(2) = sub.at(0).at(1) = (edge.at(5) + edge.at(6) + 1) >> 1;
-      sub.at(3).at(3) = sub.at(1).at(2) =
-          (edge.at(5) + edge.at(6) + edge.at(6) + edge.at(7) + 2) >> 2;
-      sub.at(2).at(3) = sub.at(0).at(2) = (edge.at(6) + edge.at(7) + 1) >> 1;
-      sub.at(1).at(3) =
-          (edge.at(6) + edge.at(7) + edge.at(7) + edge.at(8) + 2) >> 2;
-      sub.at(0).at(3) = (edge.at(7) + edge.at(8) + 1) >> 1;
-      break;
-    }
-
-    case B_VL_PRED: {
-      sub.at(0).at(0) = (above.at(0) + above.at(1) + 1) >> 1;
-      sub.at(1).at(0) =
-          (above.at(0) + above.at(1) + above.at(1) + above.at(2) + 2) >> 2;
-      sub.at(2).at(0) = sub.at(0).at(1) = (above.at(1) + above.at(2) + 1) >> 1;
-      sub.at(1).at(1) = sub.at(3).at(0) =
-          (above.at(1) + above.at(2) + above.at(2) + above.at(3) + 2) >> 2;
-      sub.at(2).at(1) = sub.at(0).at(2) = (above.at(2) + above.at(3) + 1) >> 1;
-      sub.at(3).at(1) = sub.at(1).at(2) =
-          (above.at(2) + above.at(3) + above.at(3) + above.at(4) + 2) >> 2;
-      sub.at(2).at(2) = sub.at(0).at(3) = (above.at(3) + above.at(4) + 1) >> 1;
-      sub.at(3).at(2) = sub.at(1).at(3) =
-          (above.at(3) + above.at(4) + above.at(4) + above.at(5) + 2) >> 2;
-      sub.at(2).at(3) =
-          (above.at(4) + above.at(5) + above.at(5) + above.at(6) + 2) >> 2;
-      sub.at(3).at(3) =
-          (above.at(5) + above.at(6) + above.at(6) + above.at(7) + 2) >> 2;
-      break;
-    }
-
-    case B_HD_PRED: {
-      sub.at(3).at(0) = (edge.at(0) + edge.at(1) + 1) >> 1;
-      sub.at(3).at(1) =
-          (edge.at(0) + edge.at(1) + edge.at(1) + edge.at(2) + 2) >> 2;
-      sub.at(2).at(0) = sub.at(3).at(2) = (edge.at(1) + edge.at(2) + 1) >> 1;
-      sub.at(2).at(1) = sub.at(3).at(3) =
-          (edge.at(1) + edge.at(2) + edge.at(2) + edge.at(3) + 2) >> 2;
-      sub.at(2).at(2) = sub.at(1).at(0) = (edge.at(2) + edge.at(3) + 1) >> 1;
-      sub.at(2).at(3) = sub.at(1).at(1) =
-          (edge.at(2) + edge.at(3) + edge.at(3) + edge.at(4) + 2) >> 2;
-      sub.at(1).at(2) = sub.at(0).at(0) = (edge.at(3) + edge.at(4) + 1) >> 1;
-      sub.at(1).at(3) = sub.at(0).at(1) =
-          (edge.at(3) + edge.at(4) + edge.at(4) + edge.at(5) + 2) >> 2;
-      sub.at(0).at(2) =
-          (edge.at(4) + edge.at(5) + edge.at(5) + edge.at(6) + 2) >> 2;
-      sub.at(0).at(3) =
-          (edge.at(5) + edge.at(6) + edge.at(6) + edge.at(7) + 2) >> 2;
-      break;
-    }
-
-    case B_HU_PRED: {
-      sub.at(0).at(0) = (left.at(0) + left.at(1) + 1) >> 1;
-      sub.at(0).at(1) =
-          (left.at(0) + left.at(1) + left.at(1) + left.at(2) + 2) >> 2;
-      sub.at(0).at(2) = sub.at(1).at(0) = (left.at(1) + left.at(2) + 1) >> 1;
-      sub.at(0).at(3) = sub.at(1).at(1) =
-          (left.at(1) + left.at(2) + left.at(2) + left.at(3) + 2) >> 2;
-      sub.at(1).at(2) = sub.at(2).at(0) = (left.at(2) + left.at(3) + 1) >> 1;
-      sub.at(1).at(3) = sub.at(2).at(1) =
-          (left.at(2) + left.at(3) + left.at(3) + left.at(3) + 2) >> 2;
-      sub.at(2).at(2) = sub.at(2).at(3) = sub.at(3).at(0) = sub.at(3).at(1) =
-          sub.at(3).at(2) = sub.at(3).at(3) = left.at(3);
-      break;
-    }
-
-    default:
-      ensure(false, "[Error] BPredSubBlock: Unknown subblock mode.");
-      break;
-  }
+void BPredSubBlock(const std::array<uint8_t, 8> &above,
+                   const std::array<uint8_t, 4> &left, uint8_t p,
+                   SubBlockMode mode, const SubBlock &sub) {
+  check(mode < kNumIntraBModes,
+        "[Error] BPredSubBlock: Unknown subblock mode.");
+  // The kernels read the edges from around the subblock: p and above in the
+  // first row, then left in the first column of each row of the subblock.
+  uint8_t block[5][16] = {};
+  block[0][0] = p;
+  std::copy(above.begin(), above.end(), block[0] + 1);
+  for (size_t i = 0; i < 4; ++i) block[i + 1][0] = left.at(i);
+  Dsp().pred4[mode](block[0] + 1, block[1] + 1, sizeof(block[0]));
+  for (size_t i = 0; i < 4; ++i) std::memcpy(sub.at(i), block[i + 1] + 1, 4);
 }
 
 }  // namespace internal
 
-std::array<Context, 2> IntraPredict(const FrameTag &tag, size_t r, size_t c,
-                                    const ResidualValue &rv,
-                                    const IntraMBHeader &mh,
-                                    const std::array<Context, 2> &context,
-                                    std::vector<std::vector<uint8_t>> &skip_lf,
-                                    const std::unique_ptr<BitstreamParser> &ps,
-                                    const std::shared_ptr<Frame> &frame) {
-  if (mh.intra_y_mode == B_PRED) skip_lf.at(r).at(c) = 0;
+template <bool kKeyFrame>
+std::array<Context, 2> ReadIntraModes(const std::array<Context, 2> &context,
+                                      const std::unique_ptr<BitstreamParser> &ps,
+                                      IntraMBHeader &mh) {
   std::array<Context, 2> ctx{};
 
   switch (mh.intra_y_mode) {
     case V_PRED:
-      internal::VPredLuma(r, c, frame->Y);
       ctx.at(0) = ctx.at(1) = Context(kAllVPred);
-      ApplyMBResidual(rv.y, rv.zero, frame->Y.at(r).at(c));
       break;
 
     case H_PRED:
-      internal::HPredLuma(r, c, frame->Y);
       ctx.at(0) = ctx.at(1) = Context(kAllHPred);
-      ApplyMBResidual(rv.y, rv.zero, frame->Y.at(r).at(c));
       break;
 
     case DC_PRED:
-      internal::DCPredLuma(r, c, frame->Y);
       ctx.at(0) = ctx.at(1) = Context(kAllDCPred);
-      ApplyMBResidual(rv.y, rv.zero, frame->Y.at(r).at(c));
       break;
 
     case TM_PRED:
-      internal::TMPredLuma(r, c, frame->Y);
       ctx.at(0) = ctx.at(1) = Context(kAllTMPred);
-      ApplyMBResidual(rv.y, rv.zero, frame->Y.at(r).at(c));
       break;
 
-    case B_PRED:
-      ctx = internal::BPredLuma(r, c, tag.key_frame, rv, context, ps, frame->Y);
+    case B_PRED: {
+      Context row = context.at(1).ctx;
+      Context col = context.at(0).ctx;
+      for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+          SubBlockMode mode =
+              kKeyFrame ? ps->ReadSubBlockBModeKF(col.mode(j), row.mode(i))
+                        : ps->ReadSubBlockBModeNonKF();
+          if (i == 3) ctx.at(0).append(j, mode);
+          if (j == 3) ctx.at(1).append(i, mode);
+          col.append(j, mode);
+          row.append(i, mode);
+          mh.sub_modes.at(i << 2 | j) = mode;
+        }
+      }
       break;
+    }
 
     default:
-      ensure(false, "[Error] IntraPredict: Unknown Y mode.");
+      check(false, "[Error] ReadIntraModes: Unknown Y mode.");
       break;
   }
-  MacroBlockMode intra_uv_mode = tag.key_frame ? ps->ReadIntraMB_UVModeKF()
-                                               : ps->ReadIntraMB_UVModeNonKF();
-  switch (intra_uv_mode) {
-    case V_PRED:
-      internal::VPredChroma(r, c, frame->U);
-      internal::VPredChroma(r, c, frame->V);
-      break;
-
-    case H_PRED:
-      internal::HPredChroma(r, c, frame->U);
-      internal::HPredChroma(r, c, frame->V);
-      break;
-
-    case DC_PRED:
-      internal::DCPredChroma(r, c, frame->U);
-      internal::DCPredChroma(r, c, frame->V);
-      break;
-
-    case TM_PRED:
-      internal::TMPredChroma(r, c, frame->U);
-      internal::TMPredChroma(r, c, frame->V);
-      break;
+  mh.intra_uv_mode =
+      kKeyFrame ? ps->ReadIntraMB_UVModeKF() : ps->ReadIntraMB_UVModeNonKF();
+  return ctx;
+}
 
-    default:
-      ensure(false, "[Error] IntraPredict: Unknown UV mode.");
-      break;
+template std::array<Context, 2> ReadIntraModes<false>(
+    const std::array<Context, 2> &context,
+    const std::unique_ptr<BitstreamParser> &ps, IntraMBHeader &mh);
+template std::array<Context, 2> ReadIntraModes<true>(
+    const std::array<Context, 2> &context,
+    const std::unique_ptr<BitstreamParser> &ps, IntraMBHeader &mh);
+
+void IntraPredict(size_t r, size_t c, const MacroBlockResidual &res,
+                  const IntraMBHeader &mh,
+                  std::vector<std::vector<uint8_t>> &skip_lf,
+                  const std::shared_ptr<Frame> &frame) {
+  if (mh.intra_y_mode == B_PRED) {
+    skip_lf.at(r).at(c) = 0;
+    internal::BPredLuma(r, c, res, mh.sub_modes, frame->Y);
+  } else {
+    check(mh.intra_y_mode < B_PRED, "[Error] IntraPredict: Unknown Y mode.");
+    internal::PredictMB(r, c, mh.intra_y_mode, frame->Y);
+    ApplyMBResidual(res.rd, 1, res.ydqf, frame->Y.at(r, c));
   }
-  ApplyMBResidual(rv.u, rv.zero >> 16, frame->U.at(r).at(c));
-  ApplyMBResidual(rv.v, rv.zero >> 20, frame->V.at(r).at(c));
-  return ctx;
+  check(mh.intra_uv_mode < B_PRED, "[Error] IntraPredict: Unknown UV mode.");
+  internal::PredictMB(r, c, mh.intra_uv_mode, frame->U);
+  internal::PredictMB(r, c, mh.intra_uv_mode, frame->V);
+  ApplyMBResidual(res.rd, 17, res.uvdqf, frame->U.at(r, c));
+  ApplyMBResidual(res.rd, 21, res.uvdqf, frame->V.at(r, c));
 }
 
 }  // namespace vp8
@@ -26,10 +26,19 @@ constexpr uint16_t kAllTMPred =
 
 namespace internal {
 
-constexpr int16_t kUpperPixel = 127;
-constexpr int16_t kUpperLeftPixel = 128;
-constexpr int16_t kLeftPixel = 129;
+constexpr uint8_t kUpperPixel = 127;
+constexpr uint8_t kUpperLeftPixel = 128;
+constexpr uint8_t kLeftPixel = 129;
 
+// Set the pixels above the planes of frame (from the above-left one to the
+// above-right ones of the last macroblock) to kUpperPixel and the ones to
+// their left to kLeftPixel, which the macroblocks on the top and left edges
+// are predicted from. The predictors then read them like any other pixel;
+// ExtendBorders overwrites them.
+void InitIntraEdges(Frame &frame);
+
+// Predict macroblock (r, c) of the plane in place from the pixels around it,
+// the edges of the plane being set by InitIntraEdges.
 void VPredChroma(size_t r, size_t c, Plane<2> &mb);
 void HPredChroma(size_t r, size_t c, Plane<2> &mb);
 void DCPredChroma(size_t r, size_t c, Plane<2> &mb);
@@ -40,24 +49,39 @@ void HPredLuma(size_t r, size_t c, Plane<4> &mb);
 void DCPredLuma(size_t r, size_t c, Plane<4> &mb);
 void TMPredLuma(size_t r, size_t c, Plane<4> &mb);
 
-std::array<Context, 2> BPredLuma(size_t r, size_t c, bool is_key_frame,
-                                 const ResidualValue &rv,
-                                 const std::array<Context, 2> &context,
-                                 const std::unique_ptr<BitstreamParser> &ps,
-                                 Plane<4> &mb);
+// Predict the subblocks of macroblock (r, c) one after the other, adding the
+// residual of each before predicting the next.
+void BPredLuma(size_t r, size_t c, const MacroBlockResidual &res,
+               const std::array<SubBlockMode, 16> &sub_modes, Plane<4> &mb);
+
+// Gather the 8 pixels above (including the above-right ones), the 4 pixels to
+// the left and the above-left pixel of subblock (i, j) in macroblock (r, c).
+void BPredEdges(size_t r, size_t c, size_t i, size_t j, Plane<4> &mb,
+                std::array<uint8_t, 8> &above, std::array<uint8_t, 4> &left,
+                uint8_t &p);
 
-void BPredSubBlock(const std::array<int16_t, 8> &above,
-                   const std::array<int16_t, 4> &left, int16_t p,
-                   SubBlockMode mode, SubBlock &sub);
+// Predict sub with mode from edges gathered by BPredEdges.
+void BPredSubBlock(const std::array<uint8_t, 8> &above,
+                   const std::array<uint8_t, 4> &left, uint8_t p,
+                   SubBlockMode mode, const SubBlock &sub);
 }  // namespace internal
 
-std::array<Context, 2> IntraPredict(const FrameTag &tag, size_t r, size_t c,
-                                    const ResidualValue &rv,
-                                    const IntraMBHeader &mh,
-                                    const std::array<Context, 2> &context,
-                                    std::vector<std::vector<uint8_t>> &skip_lf,
-                                    const std::unique_ptr<BitstreamParser> &ps,
-                                    const std::shared_ptr<Frame> &frame);
+// Read the subblock modes (if B_PRED) and the chroma mode of an intra
+// macroblock into mh. context holds the subblock modes bordering the
+// macroblock from above and from the left; the ones to be used by the
+// macroblocks below and to the right are returned. Key frames code the modes
+// with their own probabilities.
+template <bool kKeyFrame>
+std::array<Context, 2> ReadIntraModes(const std::array<Context, 2> &context,
+                                      const std::unique_ptr<BitstreamParser> &ps,
+                                      IntraMBHeader &mh);
+
+// Predict macroblock (r, c) from its already reconstructed neighbours and add
+// the residual.
+void IntraPredict(size_t r, size_t c, const MacroBlockResidual &res,
+                  const IntraMBHeader &mh,
+                  std::vector<std::vector<uint8_t>> &skip_lf,
+                  const std::shared_ptr<Frame> &frame);
 
 }  // namespace vp8
 
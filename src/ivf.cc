@@ -0,0 +1,77 @@
+#include "ivf.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace vp8 {
+namespace {
+
+constexpr size_t kFileHeaderSize = 32;
+constexpr size_t kFrameHeaderSize = 12;
+
+uint32_t Read16(const uint8_t *p) {
+  return uint32_t(p[0]) | uint32_t(p[1]) << 8;
+}
+
+uint32_t Read32(const uint8_t *p) { return Read16(p) | Read16(p + 2) << 16; }
+
+uint32_t FourCC(char a, char b, char c, char d) {
+  return uint32_t(a) | (uint32_t(b) << 8) | (uint32_t(c) << 16) |
+         (uint32_t(d) << 24);
+}
+
+}  // namespace
+
+IvfReader::IvfReader(const char *filename)
+    : data_(nullptr), size_(0), header_(), index_() {
+  int fd = open(filename, O_RDONLY);
+  ensure(fd >= 0, "[Error] IvfReader: Fail to open file.");
+  struct stat st;
+  ensure(fstat(fd, &st) == 0, "[Error] IvfReader: Fail to stat file.");
+  size_ = size_t(st.st_size);
+  ensure(size_ >= kFileHeaderSize, "[Error] IvfReader: File too short.");
+
+  void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  ensure(addr != MAP_FAILED, "[Error] IvfReader: Fail to map file.");
+  data_ = static_cast<const uint8_t *>(addr);
+  // The payloads are usually read front to back.
+  madvise(addr, size_, MADV_SEQUENTIAL);
+
+  ensure(Read32(data_) == FourCC('D', 'K', 'I', 'F'),
+         "[Error] IvfReader: Incorrect signature.");
+  ensure(Read16(data_ + 4) == 0, "[Error] IvfReader: Unsupported version.");
+  ensure(Read16(data_ + 6) == kFileHeaderSize,
+         "[Error] IvfReader: Incorrect header length.");
+  ensure(Read32(data_ + 8) == FourCC('V', 'P', '8', '0'),
+         "[Error] IvfReader: Not a VP8 stream.");
+  header_.width = uint16_t(Read16(data_ + 12));
+  header_.height = uint16_t(Read16(data_ + 14));
+  header_.frame_rate = Read32(data_ + 16);
+  header_.time_scale = Read32(data_ + 20);
+  header_.num_frames = Read32(data_ + 24);
+
+  index_.reserve(
+      std::min(size_t(header_.num_frames), size_ / kFrameHeaderSize));
+  size_t pos = kFileHeaderSize;
+  while (size_ - pos >= kFrameHeaderSize) {
+    IvfFrame frame;
+    frame.size = Read32(data_ + pos);
+    frame.timestamp = uint64_t(Read32(data_ + pos + 4)) |
+                      uint64_t(Read32(data_ + pos + 8)) << 32;
+    frame.offset = pos + kFrameHeaderSize;
+    if (size_ - frame.offset < frame.size) break;
+    index_.push_back(frame);
+    pos = frame.offset + frame.size;
+  }
+}
+
+IvfReader::~IvfReader() {
+  munmap(const_cast<uint8_t *>(data_), size_);
+}
+
+}  // namespace vp8
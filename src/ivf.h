@@ -0,0 +1,63 @@
+#ifndef IVF_H_
+#define IVF_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils.h"
+
+namespace vp8 {
+
+// The 32-byte file header of an IVF file.
+struct IvfHeader {
+  uint16_t width, height;
+  uint32_t frame_rate, time_scale;
+  // As written by the muxer; the actual number of frames is IvfReader::size().
+  uint32_t num_frames;
+};
+
+// The position of a frame in the file, as given by its 12-byte frame header.
+struct IvfFrame {
+  // The offset of the payload (the compressed frame) from the file start.
+  size_t offset;
+  uint32_t size;
+  uint64_t timestamp;
+};
+
+// A read-only, memory-mapped IVF file holding a VP8 stream. The file header is
+// validated and the frame headers are indexed once when the file is opened;
+// the payloads are handed out as views into the mapping without being copied.
+class IvfReader {
+ public:
+  explicit IvfReader(const char *filename);
+  ~IvfReader();
+
+  IvfReader(const IvfReader &) = delete;
+  IvfReader &operator=(const IvfReader &) = delete;
+
+  const IvfHeader &header() const { return header_; }
+
+  // The number of complete frames in the file; a truncated last frame is
+  // ignored.
+  size_t size() const { return index_.size(); }
+
+  const IvfFrame &FrameAt(size_t idx) const { return index_.at(idx); }
+
+  // The payload of the idx-th frame, valid as long as the reader is alive.
+  SpanReader<uint8_t> Payload(size_t idx) const {
+    const IvfFrame &frame = index_.at(idx);
+    return SpanReader<uint8_t>(data_ + frame.offset,
+                               data_ + frame.offset + frame.size);
+  }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+  IvfHeader header_;
+  std::vector<IvfFrame> index_;
+};
+
+}  // namespace vp8
+
+#endif  // IVF_H_
@@ -0,0 +1,123 @@
+#include "md5.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vp8 {
+namespace {
+
+constexpr std::array<uint32_t, 64> kSine = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+    0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+    0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+    0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+    0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+    0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+constexpr std::array<uint32_t, 16> kShift = {7, 12, 17, 22, 5, 9,  14, 20,
+                                             4, 11, 16, 23, 6, 10, 15, 21};
+
+inline uint32_t RotateLeft(uint32_t x, uint32_t n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+}  // namespace
+
+MD5::MD5() : state_(), length_(0), buffer_() { Reset(); }
+
+void MD5::Reset() {
+  state_ = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+  length_ = 0;
+}
+
+void MD5::Transform(const uint8_t *block) {
+  std::array<uint32_t, 16> m;
+  for (size_t i = 0; i < 16; ++i) {
+    m[i] = uint32_t(block[4 * i]) | uint32_t(block[4 * i + 1]) << 8 |
+           uint32_t(block[4 * i + 2]) << 16 | uint32_t(block[4 * i + 3]) << 24;
+  }
+  uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+  for (size_t i = 0; i < 64; ++i) {
+    uint32_t f;
+    size_t g;
+    if (i < 16) {
+      f = (b & c) | (~b & d);
+      g = i;
+    } else if (i < 32) {
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) & 15;
+    } else if (i < 48) {
+      f = b ^ c ^ d;
+      g = (3 * i + 5) & 15;
+    } else {
+      f = c ^ (b | ~d);
+      g = (7 * i) & 15;
+    }
+    uint32_t t = d;
+    d = c;
+    c = b;
+    b += RotateLeft(a + f + kSine[i] + m[g], kShift[(i >> 4) << 2 | (i & 3)]);
+    a = t;
+  }
+  state_[0] += a;
+  state_[1] += b;
+  state_[2] += c;
+  state_[3] += d;
+}
+
+void MD5::Update(const uint8_t *data, size_t size) {
+  size_t used = length_ & 63;
+  length_ += size;
+  if (used > 0) {
+    size_t n = std::min(size, 64 - used);
+    std::memcpy(buffer_.data() + used, data, n);
+    data += n;
+    size -= n;
+    if (used + n < 64) return;
+    Transform(buffer_.data());
+  }
+  for (; size >= 64; data += 64, size -= 64) Transform(data);
+  std::memcpy(buffer_.data(), data, size);
+}
+
+std::array<uint8_t, 16> MD5::Final() {
+  uint64_t bits = length_ << 3;
+  const uint8_t pad = 0x80, zero = 0;
+  Update(&pad, 1);
+  while ((length_ & 63) != 56) Update(&zero, 1);
+  std::array<uint8_t, 8> size;
+  for (size_t i = 0; i < 8; ++i) size[i] = uint8_t(bits >> (8 * i));
+  Update(size.data(), size.size());
+
+  std::array<uint8_t, 16> digest;
+  for (size_t i = 0; i < 16; ++i)
+    digest[i] = uint8_t(state_[i >> 2] >> (8 * (i & 3)));
+  return digest;
+}
+
+std::string MD5::HexDigest() {
+  static const char kHex[] = "0123456789abcdef";
+  std::string res;
+  for (uint8_t byte : Final()) {
+    res.push_back(kHex[byte >> 4]);
+    res.push_back(kHex[byte & 15]);
+  }
+  return res;
+}
+
+void UpdateFrame(MD5 &md5, const FrameView &frame) {
+  size_t vsize = (frame.height + 1) >> 1, hsize = (frame.width + 1) >> 1;
+  for (size_t r = 0; r < frame.height; ++r)
+    md5.Update(frame.planes[0] + r * frame.strides[0], frame.width);
+  for (size_t p = 1; p < 3; ++p) {
+    for (size_t r = 0; r < vsize; ++r)
+      md5.Update(frame.planes[p] + r * frame.strides[p], hsize);
+  }
+}
+
+}  // namespace vp8
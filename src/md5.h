@@ -0,0 +1,42 @@
+#ifndef MD5_H_
+#define MD5_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "vp8.h"
+
+namespace vp8 {
+
+// MD5 (RFC 1321), used to hash decoded frames the way libvpx's --md5 does.
+class MD5 {
+ public:
+  MD5();
+
+  void Update(const uint8_t *data, size_t size);
+
+  // Finish the hash; the object has to be reset before being updated again.
+  std::array<uint8_t, 16> Final();
+
+  // Final() as 32 lower-case hexadecimal digits.
+  std::string HexDigest();
+
+  void Reset();
+
+ private:
+  void Transform(const uint8_t *block);
+
+  std::array<uint32_t, 4> state_;
+  uint64_t length_;
+  std::array<uint8_t, 64> buffer_;
+};
+
+// Hash the visible pixels of frame in I420 order, straight from the planes, as
+// if the frame had been written to a .yuv file.
+void UpdateFrame(MD5 &md5, const FrameView &frame);
+
+}  // namespace vp8
+
+#endif  // MD5_H_
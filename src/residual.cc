@@ -1,5 +1,7 @@
 #include "residual.h"
 
+#include "dsp.h"
+
 namespace vp8 {
 
 ResidualData QuantizeResidualValue(const ResidualValue &rv,
@@ -39,60 +41,6 @@ ResidualData QuantizeResidualValue(const ResidualValue &rv,
   return rd;
 }
 
-ResidualValue DequantizeResidualData(ResidualData &rd, const QuantFactor &y2dqf,
-                                     const QuantFactor &ydqf,
-                                     const QuantFactor &uvdqf) {
-  ResidualValue rv{};
-  auto is_zero = [](int16_t x) { return x == 0; };
-  if (rd.has_y2) {
-    Dequantize(rd.dct_coeff.at(0), y2dqf);
-    for (size_t i = 0; i < 4; ++i) {
-      for (size_t j = 0; j < 4; ++j)
-        rv.y2.at(i).at(j) = rd.dct_coeff.at(0).at(i << 2 | j);
-    }
-  }
-  for (size_t p = 1; p <= 16; ++p) {
-    Dequantize(rd.dct_coeff.at(p), ydqf);
-    if (std::all_of(rd.dct_coeff.at(p).begin() + 1, rd.dct_coeff.at(p).end(),
-                    is_zero)) {
-      rv.zero |= (1 << (p - 1));
-      rv.y.at(p - 1).at(0).at(0) = rd.dct_coeff.at(p).at(0);
-    } else {
-      for (size_t i = 0; i < 4; ++i) {
-        for (size_t j = 0; j < 4; ++j)
-          rv.y.at(p - 1).at(i).at(j) = rd.dct_coeff.at(p).at(i << 2 | j);
-      }
-    }
-  }
-  for (size_t p = 17; p <= 20; ++p) {
-    Dequantize(rd.dct_coeff.at(p), uvdqf);
-    if (std::all_of(rd.dct_coeff.at(p).begin() + 1, rd.dct_coeff.at(p).end(),
-                    is_zero)) {
-      rv.zero |= (1 << (p - 1));
-      rv.u.at(p - 17).at(0).at(0) = rd.dct_coeff.at(p).at(0);
-    } else {
-      for (size_t i = 0; i < 4; ++i) {
-        for (size_t j = 0; j < 4; ++j)
-          rv.u.at(p - 17).at(i).at(j) = rd.dct_coeff.at(p).at(i << 2 | j);
-      }
-    }
-  }
-  for (size_t p = 21; p <= 24; ++p) {
-    Dequantize(rd.dct_coeff.at(p), uvdqf);
-    if (std::all_of(rd.dct_coeff.at(p).begin() + 1, rd.dct_coeff.at(p).end(),
-                    is_zero)) {
-      rv.zero |= (1 << (p - 1));
-      rv.v.at(p - 21).at(0).at(0) = rd.dct_coeff.at(p).at(0);
-    } else {
-      for (size_t i = 0; i < 4; ++i) {
-        for (size_t j = 0; j < 4; ++j)
-          rv.v.at(p - 21).at(i).at(j) = rd.dct_coeff.at(p).at(i << 2 | j);
-      }
-    }
-  }
-  return rv;
-}
-
 void TransformResidual(ResidualValue &rv, bool has_y2) {
   for (size_t p = 0; p < 16; ++p) DCT(rv.y.at(p));
   for (size_t p = 0; p < 4; ++p) DCT(rv.u.at(p));
@@ -107,52 +55,53 @@ void TransformResidual(ResidualValue &rv, bool has_y2) {
   }
 }
 
-void InverseTransformResidual(ResidualValue &rv, bool has_y2) {
-  if (has_y2) IWHT(rv.y2);
-  for (size_t p = 0; p < 16; ++p) {
-    if (has_y2) rv.y.at(p).at(0).at(0) = rv.y2.at(p >> 2).at(p & 3);
-    if ((rv.zero >> p & 1) == 0) IDCT(rv.y.at(p));
+void InverseTransformY2(ResidualData &rd, const QuantFactor &y2dqf) {
+  if (!rd.has_y2 || rd.eob.at(0) == 0) return;
+  std::array<int16_t, 16> &coeffs = rd.dct_coeff.at(0);
+  std::array<std::array<int16_t, 4>, 4> y2;
+  if (rd.eob.at(0) == 1) {
+    y2.at(0).at(0) = int16_t(coeffs.at(0) * y2dqf.first);
+    IWHTDC(y2);
+  } else {
+    Dequantize(coeffs, y2dqf);
+    for (size_t i = 0; i < 4; ++i) {
+      for (size_t j = 0; j < 4; ++j) y2.at(i).at(j) = coeffs.at(i << 2 | j);
+    }
+    IWHT(y2);
   }
-  for (size_t p = 0; p < 4; ++p)
-    if ((rv.zero >> (p + 16) & 1) == 0) IDCT(rv.u.at(p));
-  for (size_t p = 0; p < 4; ++p)
-    if ((rv.zero >> (p + 20) & 1) == 0) IDCT(rv.v.at(p));
+  for (size_t p = 0; p < 16; ++p)
+    rd.dct_coeff.at(p + 1).at(0) = y2.at(p >> 2).at(p & 3);
 }
 
 template <size_t C>
-void ApplyMBResidual(
-    const std::array<std::array<std::array<int16_t, 4>, 4>, C * C> &residual,
-    uint32_t zero, MacroBlock<C> &mb) {
+void ApplyMBResidual(const ResidualData &rd, size_t first,
+                     const QuantFactor &dqf, const MacroBlock<C> &mb) {
   for (size_t r = 0; r < C; ++r) {
-    for (size_t c = 0; c < C; ++c) {
-      ApplySBResidual(residual.at(r * C + c), zero & 1, mb.at(r).at(c));
-      zero >>= 1;
-    }
+    for (size_t c = 0; c < C; ++c)
+      ApplySBResidual(rd, first + r * C + c, dqf, mb.at(r, c));
   }
 }
 
-template void ApplyMBResidual<4>(
-    const std::array<std::array<std::array<int16_t, 4>, 4>, 16> &residual,
-    uint32_t zero, MacroBlock<4> &mb);
+template void ApplyMBResidual<4>(const ResidualData &rd, size_t first,
+                                 const QuantFactor &dqf,
+                                 const MacroBlock<4> &mb);
 
-template void ApplyMBResidual<2>(
-    const std::array<std::array<std::array<int16_t, 4>, 4>, 4> &residual,
-    uint32_t zero, MacroBlock<2> &mb);
+template void ApplyMBResidual<2>(const ResidualData &rd, size_t first,
+                                 const QuantFactor &dqf,
+                                 const MacroBlock<2> &mb);
 
-void ApplySBResidual(const std::array<std::array<int16_t, 4>, 4> &residual,
-                     uint8_t zero, SubBlock &sub) {
-  if (__builtin_expect(zero == 0, true)) {
-    for (size_t i = 0; i < 4; ++i) {
-      for (size_t j = 0; j < 4; ++j)
-        sub.at(i).at(j) =
-            Clamp255(int16_t(sub.at(i).at(j) + residual.at(i).at(j)));
-    }
-  } else {
-    int16_t coeff = (residual.at(0).at(0) + 4) >> 3;
-    for (size_t i = 0; i < 4; ++i) {
-      for (size_t j = 0; j < 4; ++j)
-        sub.at(i).at(j) = Clamp255(int16_t(sub.at(i).at(j) + coeff));
-    }
+void ApplySBResidual(const ResidualData &rd, size_t p, const QuantFactor &dqf,
+                     const SubBlock &sub) {
+  const std::array<int16_t, 16> &coeffs = rd.dct_coeff.at(p);
+  // The DC of a Y block of a macroblock with Y2 is dequantized already, and
+  // not accounted for by the end of block.
+  int16_t dc_factor = rd.has_y2 && p <= 16 ? 1 : dqf.first;
+  if (rd.eob.at(p) > 1) {
+    internal::Dsp().dequant_idct_add(coeffs.data(), dc_factor, dqf.second,
+                                     rd.eob.at(p), sub.at(0), sub.stride());
+  } else if (coeffs.at(0) != 0) {
+    internal::Dsp().add_dc(int16_t(coeffs.at(0) * dc_factor), sub.at(0),
+                           sub.stride());
   }
 }
 
@@ -161,15 +110,8 @@ std::array<std::array<std::array<int16_t, 4>, 4>, C * C> ComputeMBResidual(
     const MacroBlock<C> &mb, const MacroBlock<C> &target) {
   std::array<std::array<std::array<int16_t, 4>, 4>, C * C> res{};
   for (size_t r = 0; r < C; ++r) {
-    for (size_t c = 0; c < C; ++c) {
-      for (size_t i = 0; i < 4; ++i) {
-        for (size_t j = 0; j < 4; ++j) {
-          int16_t ori = mb.at(r).at(c).at(i).at(j);
-          int16_t tar = target.at(r).at(c).at(i).at(j);
-          res.at(r * C + c).at(i).at(j) = tar - ori;
-        }
-      }
-    }
+    for (size_t c = 0; c < C; ++c)
+      res.at(r * C + c) = ComputeSBResidual(mb.at(r, c), target.at(r, c));
   }
   return res;
 }
@@ -185,8 +127,8 @@ std::array<std::array<int16_t, 4>, 4> ComputeSBResidual(
   std::array<std::array<int16_t, 4>, 4> res{};
   for (size_t i = 0; i < 4; ++i) {
     for (size_t j = 0; j < 4; ++j) {
-      int16_t ori = sub.at(i).at(j);
-      int16_t tar = target.at(i).at(j);
+      int16_t ori = sub.GetPixel(i, j);
+      int16_t tar = target.GetPixel(i, j);
       res.at(i).at(j) = tar - ori;
     }
   }
@@ -4,6 +4,7 @@
 #include <array>
 
 #include "dct.h"
+#include "frame.h"
 #include "quantizer.h"
 
 namespace vp8 {
@@ -13,12 +14,17 @@ struct ResidualValue {
   std::array<std::array<std::array<int16_t, 4>, 4>, 16> y;
   std::array<std::array<std::array<int16_t, 4>, 4>, 4> u;
   std::array<std::array<std::array<int16_t, 4>, 4>, 4> v;
-  uint32_t zero;
 };
 
-ResidualValue DequantizeResidualData(ResidualData &rd, const QuantFactor &y2dqf,
-                                     const QuantFactor &ydqf,
-                                     const QuantFactor &uvdqf);
+// The residual of a macroblock on its way from the token stage to
+// reconstruction. The coefficients stay quantized, but for the DCs of the Y
+// blocks of a macroblock with Y2, which come out of InverseTransformY2:
+// ApplyMBResidual dequantizes, inverse transforms and adds each block in one
+// go.
+struct MacroBlockResidual {
+  ResidualData rd;
+  QuantFactor ydqf, uvdqf;
+};
 
 ResidualData QuantizeResidualValue(const ResidualValue &rv,
                                    const QuantFactor &y2qf,
@@ -27,22 +33,23 @@ ResidualData QuantizeResidualValue(const ResidualValue &rv,
 
 void TransformResidual(ResidualValue &rv, bool has_y2);
 
-// Perform IWHT on Y2 component (if any) and replace the first entry of each Y
-// component with the corresponding Y2 component. Then perform IDCT on both luma
-// and chroma components.
-void InverseTransformResidual(ResidualValue &rv, bool has_y2);
+// Dequantize the Y2 block of rd (if any), perform IWHT on it (IWHTDC if only
+// its DC is non-zero) and replace the DC of each Y block with the
+// corresponding entry.
+void InverseTransformY2(ResidualData &rd, const QuantFactor &y2dqf);
 
-// Apply residuals to each subblocks in the macroblock and clamp each pixel to
-// range [0, 255].
+// Dequantize, inverse transform and add blocks first, ..., first + C * C - 1
+// of rd (as indexed in ResidualData) to the subblocks of the macroblock in
+// raster-scan order, and clamp each pixel to range [0, 255].
 template <size_t C>
-void ApplyMBResidual(
-    const std::array<std::array<std::array<int16_t, 4>, 4>, C * C> &residual,
-    uint32_t zero, 
-    MacroBlock<C> &mb);
-
-// Apply residuals to the subblock and clamp each pixel to range [0, 255].
-void ApplySBResidual(const std::array<std::array<int16_t, 4>, 4> &residual,
-                     uint8_t zero, SubBlock &sub);
+void ApplyMBResidual(const ResidualData &rd, size_t first,
+                     const QuantFactor &dqf, const MacroBlock<C> &mb);
+
+// Dequantize, inverse transform and add block p of rd to the subblock and
+// clamp each pixel to range [0, 255]. All-zero blocks are skipped and DC-only
+// ones only add their DC.
+void ApplySBResidual(const ResidualData &rd, size_t p, const QuantFactor &dqf,
+                     const SubBlock &sub);
 
 template <size_t C>
 std::array<std::array<std::array<int16_t, 4>, 4>, C * C> ComputeMBResidual(
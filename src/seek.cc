@@ -0,0 +1,106 @@
+#include "seek.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "utils.h"
+
+namespace vp8 {
+namespace {
+
+constexpr uint32_t kSidecarMagic = 0x4b463856;  // "V8FK"
+constexpr uint32_t kSidecarVersion = 1;
+
+// The sidecar is tied to the file it indexes by the number of frames and the
+// position of the last one.
+struct SidecarHeader {
+  uint32_t magic, version;
+  uint64_t num_frames, last_offset, num_entries;
+};
+
+uint64_t LastOffset(const IvfReader &ivf) {
+  return ivf.size() ? ivf.FrameAt(ivf.size() - 1).offset : 0;
+}
+
+}  // namespace
+
+KeyFrameIndex::KeyFrameIndex(const IvfReader &ivf)
+    : num_frames_(ivf.size()), last_offset_(LastOffset(ivf)), entries_() {
+  Build(ivf);
+}
+
+KeyFrameIndex::KeyFrameIndex(const IvfReader &ivf, const std::string &path)
+    : num_frames_(ivf.size()), last_offset_(LastOffset(ivf)), entries_() {
+  if (Load(ivf, path)) return;
+  Build(ivf);
+  Save(path);
+}
+
+void KeyFrameIndex::Build(const IvfReader &ivf) {
+  entries_.clear();
+  for (size_t i = 0; i < ivf.size(); ++i) {
+    // Bit 0 of the frame tag is 0 for key frames.
+    const IvfFrame &frame = ivf.FrameAt(i);
+    if (frame.size == 0 || (ivf.Payload(i).ReadByte() & 1)) continue;
+    entries_.push_back({uint32_t(i), frame.size, frame.offset});
+  }
+}
+
+bool KeyFrameIndex::Load(const IvfReader &ivf, const std::string &path) {
+  std::ifstream fs(path, std::ios::binary);
+  if (!fs) return false;
+  SidecarHeader header{};
+  fs.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!fs || header.magic != kSidecarMagic ||
+      header.version != kSidecarVersion || header.num_frames != num_frames_ ||
+      header.last_offset != last_offset_ || header.num_entries > ivf.size())
+    return false;
+
+  std::vector<Entry> entries(header.num_entries);
+  fs.read(reinterpret_cast<char *>(entries.data()),
+          std::streamsize(entries.size() * sizeof(Entry)));
+  if (!fs) return false;
+  for (const Entry &entry : entries) {
+    if (entry.frame >= ivf.size()) return false;
+    const IvfFrame &frame = ivf.FrameAt(entry.frame);
+    if (frame.offset != entry.offset || frame.size != entry.size) return false;
+  }
+  entries_ = std::move(entries);
+  return true;
+}
+
+bool KeyFrameIndex::Save(const std::string &path) const {
+  std::ofstream fs(path, std::ios::binary);
+  if (!fs) return false;
+  SidecarHeader header{kSidecarMagic, kSidecarVersion, num_frames_,
+                       last_offset_, entries_.size()};
+  fs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  fs.write(reinterpret_cast<const char *>(entries_.data()),
+           std::streamsize(entries_.size() * sizeof(Entry)));
+  return bool(fs);
+}
+
+size_t KeyFrameIndex::KeyFrameBefore(size_t frame) const {
+  auto it = std::upper_bound(
+      entries_.begin(), entries_.end(), frame,
+      [](size_t f, const Entry &entry) { return f < entry.frame; });
+  return it == entries_.begin() ? 0 : std::prev(it)->frame;
+}
+
+std::optional<FrameView> Seeker::Next() {
+  SpanReader<uint8_t> payload = ivf_.Payload(position_++);
+  return decoder_.Decode(payload.cursor(), payload.size());
+}
+
+std::optional<FrameView> Seeker::Seek(size_t frame) {
+  if (frame >= ivf_.size()) return std::nullopt;
+  // Frames between the key frame and the target still have to be decoded, but
+  // only to update the reference frames.
+  size_t key_frame = index_.KeyFrameBefore(frame);
+  if (position_ <= key_frame || position_ > frame) position_ = key_frame;
+  std::optional<FrameView> view;
+  while (position_ <= frame) view = Next();
+  return view;
+}
+
+}  // namespace vp8
@@ -0,0 +1,76 @@
+#ifndef SEEK_H_
+#define SEEK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ivf.h"
+#include "vp8.h"
+
+namespace vp8 {
+
+// The positions of the key frames of an IVF file. Building it only looks at
+// the first byte of each frame; it can also be saved to (and loaded from) a
+// sidecar file so that large files are not scanned again.
+class KeyFrameIndex {
+ public:
+  struct Entry {
+    uint32_t frame;
+    uint32_t size;
+    uint64_t offset;
+  };
+
+  explicit KeyFrameIndex(const IvfReader &ivf);
+
+  // Load the index of ivf from path, or build it and try to save it there if
+  // the sidecar is missing or does not match the file.
+  KeyFrameIndex(const IvfReader &ivf, const std::string &path);
+
+  // The last key frame at or before frame (0 if there is none).
+  size_t KeyFrameBefore(size_t frame) const;
+
+  const std::vector<Entry> &entries() const { return entries_; }
+
+  bool Save(const std::string &path) const;
+
+ private:
+  void Build(const IvfReader &ivf);
+  bool Load(const IvfReader &ivf, const std::string &path);
+
+  // Identify the indexed file in the sidecar.
+  uint64_t num_frames_, last_offset_;
+  std::vector<Entry> entries_;
+};
+
+// Random access into an IVF file: seeking to a frame decodes from the nearest
+// key frame before it, or continues from the current position if that is
+// closer.
+class Seeker {
+ public:
+  Seeker(const IvfReader &ivf, const KeyFrameIndex &index, Decoder &decoder)
+      : ivf_(ivf), index_(index), decoder_(decoder), position_(0) {}
+
+  // Decode the next frame. Returns a view of it if it is meant to be shown.
+  std::optional<FrameView> Next();
+
+  // Decode up to frame (inclusive) and return its view if it is meant to be
+  // shown. Returns std::nullopt without decoding anything if frame is past the
+  // end of the file.
+  std::optional<FrameView> Seek(size_t frame);
+
+  // The next frame to be decoded.
+  size_t position() const { return position_; }
+
+ private:
+  const IvfReader &ivf_;
+  const KeyFrameIndex &index_;
+  Decoder &decoder_;
+  size_t position_;
+};
+
+}  // namespace vp8
+
+#endif  // SEEK_H_
@@ -0,0 +1,53 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "vp8.h"
+
+namespace vp8 {
+namespace internal {
+
+// The time stamp counter, or a nanosecond clock where there is none.
+inline uint64_t ReadCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count());
+#endif
+}
+
+// The counter of stage in cycles (the cycles of each stage, indexed by
+// DecodeStage), or nullptr if cycles is nullptr.
+inline uint64_t *StageCounter(uint64_t *cycles, DecodeStage stage) {
+  return cycles == nullptr ? nullptr : cycles + stage;
+}
+
+// Add the cycles spent in its scope to *counter, unless counter is nullptr.
+class ScopedCycles {
+ public:
+  explicit ScopedCycles(uint64_t *counter)
+      : counter_(counter), start_(counter == nullptr ? 0 : ReadCycles()) {}
+  ~ScopedCycles() {
+    if (counter_ != nullptr) *counter_ += ReadCycles() - start_;
+  }
+
+  ScopedCycles(const ScopedCycles &) = delete;
+  ScopedCycles &operator=(const ScopedCycles &) = delete;
+
+ private:
+  uint64_t *counter_;
+  uint64_t start_;
+};
+
+}  // namespace internal
+}  // namespace vp8
+
+#endif  // STATS_H_
@@ -0,0 +1,61 @@
+#include "token_reader.h"
+
+namespace vp8 {
+namespace {
+
+// Extra-bit probabilities of DCT_CAT3 to DCT_CAT6 (kPcat), zero-terminated.
+constexpr std::array<std::array<Prob, 12>, 4> kCatProbs = {
+    {{173, 148, 140, 0},
+     {176, 155, 140, 135, 0},
+     {180, 157, 141, 134, 130, 0},
+     {254, 254, 243, 230, 196, 177, 153, 140, 133, 130, 129, 0}}};
+
+// Decode the magnitude of a token known to be at least DCT_2, starting from
+// node 6 of kCoeffTree.
+inline int16_t ReadLargeToken(BoolDecoder &bd, const Prob *p) {
+  if (!bd.Bool(p[3])) {
+    if (!bd.Bool(p[4])) return 2;
+    return int16_t(3 + bd.Bool(p[5]));
+  }
+  if (!bd.Bool(p[6])) {
+    if (!bd.Bool(p[7])) return int16_t(kTokenToCoeff[DCT_CAT1] + bd.Bool(159));
+    int16_t v = int16_t(bd.Bool(165) << 1);
+    return int16_t(kTokenToCoeff[DCT_CAT2] + v + bd.Bool(145));
+  }
+  uint8_t hi = bd.Bool(p[8]);
+  uint8_t cat = uint8_t(hi << 1 | bd.Bool(p[9 + hi]));
+  int16_t v = 0;
+  for (const Prob *q = kCatProbs[cat].data(); *q; ++q)
+    v = int16_t(v + v + bd.Bool(*q));
+  return int16_t(kTokenToCoeff[DCT_CAT3 + cat] + v);
+}
+
+}  // namespace
+
+uint8_t ReadTokens(BoolDecoder &bd, const BandProbs &probs, unsigned first,
+                   unsigned ctx, std::array<int16_t, 16> &coeffs) {
+  uint8_t eob = 0;
+  unsigned n = first;
+  while (n < 16) {
+    const Prob *p = probs[kCoeffBands[n]][ctx].data();
+    if (!bd.Bool(p[0])) break;  // DCT_EOB
+    // A DCT_0 can not be followed by DCT_EOB, so runs of zeros skip node 0.
+    while (!bd.Bool(p[1])) {
+      if (++n == 16) return eob;
+      p = probs[kCoeffBands[n]][0].data();
+    }
+    int16_t v;
+    if (!bd.Bool(p[2])) {
+      v = 1;
+      ctx = 1;
+    } else {
+      v = ReadLargeToken(bd, p);
+      ctx = 2;
+    }
+    coeffs[kZigZag[n]] = bd.Bool(128) ? int16_t(-v) : v;
+    eob = uint8_t(++n);
+  }
+  return eob;
+}
+
+}  // namespace vp8
@@ -0,0 +1,29 @@
+#ifndef TOKEN_READER_H_
+#define TOKEN_READER_H_
+
+#include <array>
+#include <cstdint>
+
+#include "bitstream_const.h"
+#include "bool_decoder.h"
+
+namespace vp8 {
+
+// The coefficient probabilities of one block type, indexed by band, context and
+// tree node.
+using BandProbs =
+    std::array<std::array<std::array<Prob, kNumCoeffProb>, kNumDctContextType>,
+               kNumCoeffBand>;
+
+// Decode the DCT tokens of a 4x4 block into coeffs (in raster-scan order, which
+// must be zero-initialized), starting from the zigzag position first with the
+// given above + left context. The shape of kCoeffTree is hard-coded.
+//
+// Returns the end-of-block position, i.e. one past the zigzag position of the
+// last non-zero coefficient, or 0 if there is none.
+uint8_t ReadTokens(BoolDecoder &bd, const BandProbs &probs, unsigned first,
+                   unsigned ctx, std::array<int16_t, 16> &coeffs);
+
+}  // namespace vp8
+
+#endif  // TOKEN_READER_H_
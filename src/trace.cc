@@ -0,0 +1,90 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+
+#include "utils.h"
+
+namespace vp8 {
+namespace {
+
+// Small, stable thread ids, handed out on first use.
+std::atomic<uint32_t> next_thread_id(0);
+
+uint32_t ThreadId() {
+  thread_local uint32_t id = next_thread_id.fetch_add(1) + 1;
+  return id;
+}
+
+}  // namespace
+
+struct Tracer::Event {
+  const char *name;
+  uint64_t begin, end, frame;
+  int64_t row;
+  uint32_t thread;
+};
+
+Tracer::Tracer(size_t capacity)
+    : events_(std::make_unique<Event[]>(capacity)),
+      capacity_(capacity),
+      next_(0) {
+  if (capacity == 0)
+    throw std::invalid_argument("[Error] Tracer::Tracer: Empty buffer.");
+}
+
+Tracer::~Tracer() = default;
+
+uint64_t Tracer::Now() {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count());
+}
+
+void Tracer::Record(const char *name, uint64_t begin, uint64_t end,
+                    uint64_t frame, int64_t row) {
+  // Each span claims its own slot, overwriting the oldest one once the ring is
+  // full.
+  uint64_t idx = next_.fetch_add(1, std::memory_order_relaxed);
+  Event &event = events_[idx % capacity_];
+  event.name = name;
+  event.begin = begin;
+  event.end = end;
+  event.frame = frame;
+  event.row = row;
+  event.thread = ThreadId();
+}
+
+bool Tracer::Write(const char *filename) const {
+  std::FILE *fp = std::fopen(filename, "w");
+  if (fp == nullptr) return false;
+  uint64_t next = next_.load(std::memory_order_acquire);
+  uint64_t first = next > capacity_ ? next - capacity_ : 0;
+  uint64_t origin = first < next ? events_[first % capacity_].begin : 0;
+  for (uint64_t i = first; i < next; ++i)
+    origin = std::min(origin, events_[i % capacity_].begin);
+
+  std::fprintf(fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+  for (uint64_t i = first; i < next; ++i) {
+    const Event &event = events_[i % capacity_];
+    // Complete events, with microsecond time stamps.
+    std::fprintf(fp,
+                 "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+                 "\"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, "
+                 "\"args\": {\"frame\": %llu",
+                 i == first ? "" : ",", event.name, event.thread,
+                 double(event.begin - origin) / 1e3,
+                 double(event.end - event.begin) / 1e3,
+                 (unsigned long long)event.frame);
+    if (event.row >= 0)
+      std::fprintf(fp, ", \"row\": %lld", (long long)event.row);
+    std::fprintf(fp, "}}");
+  }
+  std::fprintf(fp, "\n]}\n");
+  return std::fclose(fp) == 0;
+}
+
+}  // namespace vp8
@@ -0,0 +1,44 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdint>
+
+#include "vp8.h"
+
+namespace vp8 {
+namespace internal {
+
+// Where the spans of a frame go: the tracer (nullptr if tracing is off) and
+// the number of the frame.
+struct FrameTrace {
+  Tracer *tracer = nullptr;
+  uint64_t frame = 0;
+};
+
+// Record its scope as a span named name, unless tracing is off.
+class ScopedSpan {
+ public:
+  ScopedSpan(const FrameTrace &trace, const char *name, int64_t row = -1)
+      : trace_(trace),
+        name_(name),
+        row_(row),
+        begin_(trace.tracer == nullptr ? 0 : Tracer::Now()) {}
+  ~ScopedSpan() {
+    if (trace_.tracer != nullptr)
+      trace_.tracer->Record(name_, begin_, Tracer::Now(), trace_.frame, row_);
+  }
+
+  ScopedSpan(const ScopedSpan &) = delete;
+  ScopedSpan &operator=(const ScopedSpan &) = delete;
+
+ private:
+  FrameTrace trace_;
+  const char *name_;
+  int64_t row_;
+  uint64_t begin_;
+};
+
+}  // namespace internal
+}  // namespace vp8
+
+#endif  // TRACE_H_
@@ -14,6 +14,18 @@ inline void ensure(bool cond, const std::string &message) {
 
 namespace vp8 {
 
+// A corrupt, truncated or unsupported frame. The decoder reports its errors by
+// throwing it through check, and Decoder::Decode turns them into an error
+// return; ensure, which ends the process, is left to the command-line tools.
+class DecodeError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+inline void check(bool cond, const char *message) {
+  if (__builtin_expect(!cond, false)) throw DecodeError(message);
+}
+
 template <typename T>
 inline T Clamp255(T x) noexcept {
   return std::clamp(x, T(0), T(255));
@@ -90,6 +102,11 @@ class SpanReader {
   }
 
   size_t size() const { return size_t(end_ - begin_); }
+
+  // The next element to be read and the end of the span, for readers which
+  // consume the span on their own.
+  const T *cursor() const { return cursor_; }
+  const T *end() const { return end_; }
 };
 
 }  // namespace vp8
@@ -0,0 +1,174 @@
+#ifndef VP8_H_
+#define VP8_H_
+
+// The public interface of the decoder library. This is the only header
+// installed along with libvp8; it does not depend on any internal header.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace vp8 {
+
+// A read-only view of a decoded frame in I420 layout. The chroma planes are
+// (width + 1) / 2 by (height + 1) / 2 pixels. Row r of plane p starts at
+// planes[p] + r * strides[p].
+struct FrameView {
+  size_t width, height;
+  // Y, U and V.
+  std::array<const uint8_t *, 3> planes;
+  std::array<size_t, 3> strides;
+};
+
+// The stages of decoding a frame, as accounted for in DecodeStats.
+enum DecodeStage {
+  // The frame tag and header.
+  STAGE_HEADER,
+  // The modes and motion vectors of the first partition.
+  STAGE_MODES,
+  // The DCT tokens.
+  STAGE_TOKENS,
+  // Dequantization and inverse transform of the Y2 blocks.
+  STAGE_TRANSFORM,
+  // Intra and inter prediction, residual included (the other blocks are
+  // dequantized and inverse transformed as they are added).
+  STAGE_PREDICT,
+  // The loop filter.
+  STAGE_FILTER,
+  // Extending the borders of the reference frame.
+  STAGE_BORDER,
+  // Not measured by the decoder; left to the application consuming the frames.
+  STAGE_OUTPUT,
+  kNumDecodeStages
+};
+
+// Counters accumulated over the frames decoded by a Decoder (see
+// Decoder::SetStats). The cycles of a stage are summed over all the threads
+// taking part in it, so they can add up to more than the elapsed time.
+struct DecodeStats {
+  uint64_t frames = 0, key_frames = 0;
+  // Time stamp counter cycles (nanoseconds where there is none) per stage.
+  std::array<uint64_t, kNumDecodeStages> cycles{};
+  // Macroblocks by prediction mode: whole-macroblock intra, B_PRED, and inter
+  // from the last, golden and altref frames. Skipped macroblocks (with no
+  // non-zero coefficient) are also counted on their own.
+  uint64_t intra_mbs = 0, bpred_mbs = 0;
+  std::array<uint64_t, 3> inter_mbs{};
+  uint64_t skipped_mbs = 0;
+  // Compressed bytes of the frame tags and first partitions, and of each DCT
+  // partition.
+  uint64_t first_partition_bytes = 0;
+  std::array<uint64_t, 8> partition_bytes{};
+  // The high-water mark of the frame buffers held by the decoder at the same
+  // time (the frame being decoded and the reference frames).
+  uint64_t frame_buffers = 0;
+};
+
+// An opt-in recorder of what the decoder spends its time on, exported in the
+// Chrome trace event format (for about:tracing or Perfetto). The spans are
+// kept in a ring buffer allocated up front, which only holds the most recent
+// capacity spans; recording one takes an atomic increment and a few stores.
+// The capacity must be positive (std::invalid_argument otherwise).
+class Tracer {
+ public:
+  explicit Tracer(size_t capacity = 1 << 16);
+  ~Tracer();
+
+  Tracer(const Tracer &) = delete;
+  Tracer &operator=(const Tracer &) = delete;
+
+  // Nanoseconds since an arbitrary (fixed) point in time.
+  static uint64_t Now();
+
+  // Record the span [begin, end) (as given by Now()) of the calling thread,
+  // tagged with the number of the frame being decoded and, if not negative,
+  // a macroblock row. name must outlive the tracer. Safe to call from several
+  // threads at once.
+  void Record(const char *name, uint64_t begin, uint64_t end, uint64_t frame,
+              int64_t row = -1);
+
+  // Write the recorded spans to filename as JSON; no span may be recorded
+  // meanwhile. Returns false if the file cannot be written.
+  bool Write(const char *filename) const;
+
+ private:
+  struct Event;
+
+  std::unique_ptr<Event[]> events_;
+  size_t capacity_;
+  std::atomic<uint64_t> next_;
+};
+
+// The instruction set levels the hot kernels (inverse transforms, residual,
+// subpixel interpolation, prediction and loop filter) are built for. The level
+// is picked when the first Decoder is constructed: the highest one supported
+// by both the build and the CPU, capped by the VP8_CPU_LEVEL environment
+// variable ("scalar", "sse4.1", "avx2" or "avx512") if it is set (any other
+// value makes that constructor throw std::invalid_argument). The kernels are
+// shared by all the decoders of the process. CPU_AVX512 runs the kernels of
+// CPU_AVX2.
+enum CpuLevel { CPU_SCALAR, CPU_SSE41, CPU_AVX2, CPU_AVX512, kNumCpuLevels };
+
+// The highest level supported by both the build and the CPU.
+CpuLevel DetectCpuLevel();
+
+// The level of the kernels in use.
+CpuLevel ActiveCpuLevel();
+
+// Use the kernels of level from now on, overriding the detection and
+// VP8_CPU_LEVEL; meant for testing and benchmarking. Returns false (and
+// changes nothing) if level is above DetectCpuLevel(). Must not be called while
+// a frame is being decoded.
+bool ForceCpuLevel(CpuLevel level);
+
+// "scalar", "sse4.1", "avx2" or "avx512".
+const char *CpuLevelName(CpuLevel level);
+
+// Decoder of a single VP8 stream. Separate instances can decode separate
+// streams concurrently.
+class Decoder {
+ public:
+  // Decode each frame with up to num_threads threads.
+  explicit Decoder(size_t num_threads = 1);
+  ~Decoder();
+
+  Decoder(Decoder &&) noexcept;
+  Decoder &operator=(Decoder &&) noexcept;
+
+  // Decode the next compressed frame of the stream (one IVF frame payload).
+  // Returns a view of the frame if it is meant to be shown. The pixels stay
+  // owned by the decoder and the view is valid until the next call to Decode
+  // or the destruction of the decoder. Returns std::nullopt with error() set
+  // if the frame is corrupt, truncated or unsupported, or if the memory or the
+  // threads to decode it cannot be had, in which case every frame up to the
+  // next key frame fails as well. Never ends the process, whatever the number
+  // of threads.
+  std::optional<FrameView> Decode(const uint8_t *data, size_t size);
+
+  // Why the last call to Decode failed, or nullptr if it did not.
+  const char *error() const;
+
+  // Accumulate counters into stats (owned by the caller, which must outlive
+  // the decoding) from now on, or stop if stats is nullptr (the default).
+  // Without stats the instrumentation costs next to nothing.
+  void SetStats(DecodeStats *stats);
+
+  // Record the activity of the decoder into tracer (owned by the caller) from
+  // now on, or stop if tracer is nullptr (the default).
+  void SetTracer(Tracer *tracer);
+
+  // The dimensions of the stream, as given by the last key frame.
+  size_t height() const;
+  size_t width() const;
+
+ private:
+  class Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}  // namespace vp8
+
+#endif  // VP8_H_
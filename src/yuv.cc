@@ -4,26 +4,21 @@ namespace vp8 {
 
 template <>
 void YUV<WRITE>::WriteFrame(const std::shared_ptr<Frame> &frame) {
-  for (size_t r = 0; r < frame->vsize; ++r) {
-    for (size_t c = 0; c < frame->hsize; ++c) {
-      uint8_t y =
-          uint8_t(frame->Y.at(r >> 4).at(c >> 4).GetPixel(r & 15, c & 15));
-      WriteByte(y);
-    }
-  }
-  for (size_t r = 0; r < frame->vsize; r += 2) {
-    for (size_t c = 0; c < frame->hsize; c += 2) {
-      uint8_t u = uint8_t(
-          frame->U.at(r >> 4).at(c >> 4).GetPixel((r >> 1) & 7, (c >> 1) & 7));
-      WriteByte(u);
-    }
-  }
-  for (size_t r = 0; r < frame->vsize; r += 2) {
-    for (size_t c = 0; c < frame->hsize; c += 2) {
-      uint8_t v = uint8_t(
-          frame->V.at(r >> 4).at(c >> 4).GetPixel((r >> 1) & 7, (c >> 1) & 7));
-      WriteByte(v);
-    }
+  for (size_t r = 0; r < frame->vsize; ++r)
+    WriteBytes(frame->Y.Row(r), frame->hsize);
+  size_t vsize = (frame->vsize + 1) >> 1, hsize = (frame->hsize + 1) >> 1;
+  for (size_t r = 0; r < vsize; ++r) WriteBytes(frame->U.Row(r), hsize);
+  for (size_t r = 0; r < vsize; ++r) WriteBytes(frame->V.Row(r), hsize);
+}
+
+template <>
+void YUV<WRITE>::WriteFrame(const FrameView &view) {
+  size_t vsize = (view.height + 1) >> 1, hsize = (view.width + 1) >> 1;
+  for (size_t r = 0; r < view.height; ++r)
+    WriteBytes(view.planes[0] + r * view.strides[0], view.width);
+  for (size_t p = 1; p < 3; ++p) {
+    for (size_t r = 0; r < vsize; ++r)
+      WriteBytes(view.planes[p] + r * view.strides[p], hsize);
   }
 }
 
@@ -31,22 +26,16 @@ template <>
 Frame YUV<READ>::ReadFrame(size_t height, size_t width) {
   Frame res(height, width);
   for (size_t r = 0; r < height; ++r) {
-    for (size_t c = 0; c < width; ++c) {
-      uint8_t y = ReadByte();
-      res.Y.at(r >> 4).at(c >> 4).SetPixel(r & 15, c & 15, y);
-    }
+    uint8_t *row = res.Y.Row(r);
+    for (size_t c = 0; c < width; ++c) row[c] = ReadByte();
   }
   for (size_t r = 0; r < height; r += 2) {
-    for (size_t c = 0; c < width; c += 2) {
-      uint8_t u = ReadByte();
-      res.U.at(r >> 4).at(c >> 4).SetPixel((r >> 1) & 7, (c >> 1) & 7, u);
-    }
+    uint8_t *row = res.U.Row(r >> 1);
+    for (size_t c = 0; c < width; c += 2) row[c >> 1] = ReadByte();
   }
   for (size_t r = 0; r < height; r += 2) {
-    for (size_t c = 0; c < width; c += 2) {
-      uint8_t v = ReadByte();
-      res.V.at(r >> 4).at(c >> 4).SetPixel((r >> 1) & 7, (c >> 1) & 7, v);
-    }
+    uint8_t *row = res.V.Row(r >> 1);
+    for (size_t c = 0; c < width; c += 2) row[c >> 1] = ReadByte();
   }
   return res;
 }
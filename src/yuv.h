@@ -1,6 +1,8 @@
 #ifndef YUV_H_
 #define YUV_H_
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <string>
@@ -8,6 +10,7 @@
 
 #include "frame.h"
 #include "utils.h"
+#include "vp8.h"
 
 namespace vp8 {
 
@@ -28,6 +31,7 @@ class YUV {
   }
 
   void WriteFrame(const std::shared_ptr<Frame> &frame);
+  void WriteFrame(const FrameView &view);
   Frame ReadFrame(size_t height, size_t width);
 
  private:
@@ -40,6 +44,22 @@ class YUV {
     }
   }
 
+  template <IOMode M = Mode>
+  typename std::enable_if<M == WRITE>::type WriteBytes(const uint8_t *bytes,
+                                                       size_t n) {
+    while (n > 0) {
+      size_t len = std::min(n, kBufSize - ptr_);
+      std::memcpy(buf_.get() + ptr_, bytes, len);
+      ptr_ += len;
+      bytes += len;
+      n -= len;
+      if (ptr_ == kBufSize) {
+        fs_.write(reinterpret_cast<char *>(buf_.get()), kBufSize);
+        ptr_ = 0;
+      }
+    }
+  }
+
   template <IOMode M = Mode>
   typename std::enable_if<M == READ, uint8_t>::type ReadByte() {
     if (ptr_ == kBufSize) {
@@ -12,6 +12,7 @@ namespace vp8_test {
 
 void TestDct();
 void TestWht();
+void TestSparseTransforms();
 
 void TestDct() {
   static const size_t kTest = 100;
@@ -70,6 +71,45 @@ void TestWht() {
   std::cout << "[Test] WHT test completed." << std::endl;
 }
 
+void TestSparseTransforms() {
+  static const size_t kTest = 100;
+  static std::mt19937 kRng(2718);
+  static std::uniform_int_distribution<int16_t> kDis(-2048, 2047);
+
+  std::cout << "[Test] Sparse transforms test started." << std::endl;
+  for (size_t t = 0; t < kTest; ++t) {
+    // Only the first 4 coefficients in zigzag order (the first row and column).
+    std::array<std::array<int16_t, 4>, 4> input{};
+    input[0][0] = kDis(kRng);
+    input[0][1] = kDis(kRng);
+    input[1][0] = kDis(kRng);
+    input[2][0] = kDis(kRng);
+    if (t & 1) input[0][2] = kDis(kRng);
+    if (t & 2) input[0][3] = kDis(kRng);
+    if (t & 4) input[3][0] = kDis(kRng);
+    std::array<std::array<int16_t, 4>, 4> clone = input;
+    vp8::IDCT(input);
+    vp8::IDCTRowCol(clone);
+    assert(input == clone);
+  }
+  for (size_t t = 0; t < kTest; ++t) {
+    std::array<std::array<int16_t, 4>, 4> input{};
+    input[0][0] = kDis(kRng);
+    std::array<std::array<int16_t, 4>, 4> clone = input;
+    vp8::IDCT(input);
+    vp8::IDCTDC(clone);
+    assert(input == clone);
+
+    input = {};
+    input[0][0] = kDis(kRng);
+    clone = input;
+    vp8::IWHT(input);
+    vp8::IWHTDC(clone);
+    assert(input == clone);
+  }
+  std::cout << "[Test] Sparse transforms test completed." << std::endl;
+}
+
 }
 
 #endif  // DCT_TEST_H_
@@ -0,0 +1,117 @@
+#ifndef DECODER_TEST_H_
+#define DECODER_TEST_H_
+
+#include "../src/ivf.h"
+#include "../src/vp8.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <optional>
+
+namespace vp8_test {
+
+// The number of allocations left until the one to fail, or 0 if none is to.
+std::atomic<size_t> allocations_left(0);
+
+}
+
+// Every allocation of the test program (std::thread included) goes through
+// these, so that any one of them can be made to fail.
+void *operator new(size_t size) {
+  size_t left = vp8_test::allocations_left.load();
+  while (left > 0 &&
+         !vp8_test::allocations_left.compare_exchange_weak(left, left - 1)) {
+  }
+  if (left == 1) throw std::bad_alloc();
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+// Not inlined, or GCC warns of the free of a pointer coming from new.
+__attribute__((noinline)) void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+namespace vp8_test {
+
+void TestDecodeFailures();
+
+// Whether the pixels of both views are the same.
+bool SameFrame(const vp8::FrameView &a, const vp8::FrameView &b) {
+  if (a.width != b.width || a.height != b.height) return false;
+  for (size_t p = 0; p < 3; ++p) {
+    size_t width = p == 0 ? a.width : (a.width + 1) / 2;
+    size_t height = p == 0 ? a.height : (a.height + 1) / 2;
+    for (size_t r = 0; r < height; ++r) {
+      if (!std::equal(a.planes[p] + r * a.strides[p],
+                      a.planes[p] + r * a.strides[p] + width,
+                      b.planes[p] + r * b.strides[p]))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Decode the first two frames of filename with num_threads threads, failing
+// each allocation of the call to Decode of either in turn: the call has to
+// fail cleanly, whichever thread the allocation was made by, and decoding the
+// stream again from the key frame has to give the same frame as if it had not.
+void TestAllocationFailures(const char *filename, size_t num_threads) {
+  vp8::IvfReader ivf(filename);
+  for (size_t frame = 0; frame < 2; ++frame) {
+    vp8::Decoder reference(num_threads);
+    std::optional<vp8::FrameView> expected;
+    for (size_t i = 0; i <= frame; ++i) {
+      vp8::SpanReader<uint8_t> payload = ivf.Payload(i);
+      expected = reference.Decode(payload.cursor(), payload.size());
+      assert(expected);
+    }
+    for (size_t n = 1;; ++n) {
+      vp8::Decoder decoder(num_threads);
+      for (size_t i = 0; i < frame; ++i) {
+        vp8::SpanReader<uint8_t> payload = ivf.Payload(i);
+        std::optional<vp8::FrameView> view =
+            decoder.Decode(payload.cursor(), payload.size());
+        assert(view);
+      }
+      vp8::SpanReader<uint8_t> payload = ivf.Payload(frame);
+      allocations_left.store(n);
+      std::optional<vp8::FrameView> view =
+          decoder.Decode(payload.cursor(), payload.size());
+      // Whether the n-th allocation was reached.
+      if (allocations_left.exchange(0) != 0) {
+        assert(view && decoder.error() == nullptr);
+        break;
+      }
+      assert(!view && decoder.error() != nullptr);
+      for (size_t i = 0; i <= frame; ++i) {
+        payload = ivf.Payload(i);
+        view = decoder.Decode(payload.cursor(), payload.size());
+        assert(view && decoder.error() == nullptr);
+      }
+      assert(SameFrame(*view, *expected));
+    }
+  }
+}
+
+void TestDecodeFailures() {
+  std::cout << "[Test] Decode failures test started." << std::endl;
+  // A single DCT partition: reconstruction runs on the calling thread and the
+  // loop filter on a thread of its own.
+  TestAllocationFailures("example/vp8-test-vectors/vp80-02-inter-1402.ivf", 2);
+  // Four DCT partitions: a wavefront of four workers as well.
+  TestAllocationFailures("example/vp8-test-vectors/vp80-04-partitions-1405.ivf",
+                         4);
+  std::cout << "[Test] Decode failures test completed." << std::endl;
+}
+
+}
+
+#endif  // DECODER_TEST_H_
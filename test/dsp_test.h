@@ -0,0 +1,78 @@
+#ifndef DSP_TEST_H_
+#define DSP_TEST_H_
+
+#include "../src/bitstream_const.h"
+#include "../src/dct.h"
+#include "../src/dsp.h"
+#include "../src/quantizer.h"
+#include "../src/vp8.h"
+
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <random>
+
+namespace vp8_test {
+
+void TestResidualKernels();
+
+void TestResidualKernels() {
+  static const size_t kTest = 1000;
+  static const size_t kStride = 8;
+  static std::mt19937 kRng(31415);
+  static std::uniform_int_distribution<int16_t> kCoeff(-2048, 2047);
+  static std::uniform_int_distribution<int16_t> kFactor(1, 157);
+  static std::uniform_int_distribution<int> kPixel(0, 255);
+
+  // The end-of-block positions of a DC-only block, of blocks within the first
+  // row and column, and of a full block.
+  static const std::array<uint8_t, 5> kEobs = {1, 2, 3, 4, 16};
+
+  std::cout << "[Test] Residual kernels test started." << std::endl;
+  const std::array<const vp8::internal::DspKernels *, vp8::kNumCpuLevels>
+      kernels = {vp8::internal::ScalarKernels(), vp8::internal::Sse41Kernels(),
+                 vp8::internal::Avx2Kernels(), vp8::internal::Avx512Kernels()};
+  for (size_t level = 0; level < vp8::kNumCpuLevels; ++level) {
+    // Only the levels both built and supported by the CPU can run.
+    if (kernels[level] == nullptr || level > vp8::DetectCpuLevel()) continue;
+    const vp8::internal::DspKernels &dsp = *kernels[level];
+    for (size_t t = 0; t < kTest; ++t) {
+      uint8_t eob = kEobs[t % kEobs.size()];
+      std::array<int16_t, 16> coeffs{};
+      for (size_t i = 0; i < eob; ++i) coeffs[vp8::kZigZag[i]] = kCoeff(kRng);
+      vp8::QuantFactor dqf(kFactor(kRng), kFactor(kRng));
+      std::array<uint8_t, 4 * kStride> pixels;
+      for (uint8_t &p : pixels) p = uint8_t(kPixel(kRng));
+
+      // Dequantize, inverse transform, then add and clamp.
+      std::array<int16_t, 16> dequantized = coeffs;
+      vp8::Dequantize(dequantized, dqf);
+      std::array<std::array<int16_t, 4>, 4> block;
+      for (size_t i = 0; i < 16; ++i) block[i >> 2][i & 3] = dequantized[i];
+      vp8::IDCT(block);
+      std::array<uint8_t, 4 * kStride> expected = pixels;
+      for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+          int sum = expected[i * kStride + j] + block[i][j];
+          expected[i * kStride + j] = uint8_t(std::clamp(sum, 0, 255));
+        }
+      }
+
+      std::array<uint8_t, 4 * kStride> actual = pixels;
+      dsp.dequant_idct_add(coeffs.data(), dqf.first, dqf.second, eob,
+                           actual.data(), kStride);
+      assert(actual == expected);
+
+      if (eob == 1) {
+        actual = pixels;
+        dsp.add_dc(dequantized[0], actual.data(), kStride);
+        assert(actual == expected);
+      }
+    }
+  }
+  std::cout << "[Test] Residual kernels test completed." << std::endl;
+}
+
+}
+
+#endif  // DSP_TEST_H_
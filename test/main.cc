@@ -1,4 +1,6 @@
 #include "dct_test.h"
+#include "decoder_test.h"
+#include "dsp_test.h"
 #include "yuv_test.h"
 
 #include <iostream>
@@ -7,6 +9,9 @@ int main() {
   std::cout << "[Info] Start unit testing." << std::endl;
   vp8_test::TestDct();
   vp8_test::TestWht();
+  vp8_test::TestSparseTransforms();
+  vp8_test::TestResidualKernels();
+  vp8_test::TestDecodeFailures();
   // vp8_test::TestYuv();
   std::cout << "[Info] All unit tests completed." << std::endl;
 }